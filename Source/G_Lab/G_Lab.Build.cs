@@ -1,5 +1,6 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
+using System;
 using UnrealBuildTool;
 
 public class G_Lab : ModuleRules
@@ -8,9 +9,13 @@ public class G_Lab : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 	
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "NavigationSystem" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] {  });
+		PrivateDependencyModuleNames.AddRange(new string[] { "MassEntity", "MassCommon", "MassSpawner", "MassActors", "MassLOD", "MassRepresentation", "StructUtils" });
+
+		// Set G_LAB_IK_DEOPTIMIZE=1 in the environment to step through the IK solve without optimizations
+		bool deoptimizeIK = Environment.GetEnvironmentVariable("G_LAB_IK_DEOPTIMIZE") == "1";
+		PrivateDefinitions.Add("G_LAB_IK_DEOPTIMIZE=" + (deoptimizeIK ? "1" : "0"));
 
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
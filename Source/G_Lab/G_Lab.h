@@ -4,3 +4,4 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_STATS_GROUP(TEXT("G_Lab"), STATGROUP_GLab, STATCAT_Advanced);
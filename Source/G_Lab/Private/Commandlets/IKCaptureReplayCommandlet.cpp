@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Commandlets/IKCaptureReplayCommandlet.h"
+
+#include "Components/AnimInstances/IKCapture.h"
+
+int32 UIKCaptureReplayCommandlet::Main(const FString& Params)
+{
+    FString capturePath;
+    if (!FParse::Value(*Params, TEXT("Capture="), capturePath))
+    {
+        UE_LOG(LogTemp, Error, TEXT("IK capture replay: missing -Capture=<file>"));
+        return 1;
+    }
+
+    double tolerance = 0;
+    FParse::Value(*Params, TEXT("Tolerance="), tolerance);
+
+    FIKCaptureReplayReport report;
+    if (!FIKCaptureReplayer::Replay(capturePath, tolerance, report))
+    {
+        UE_LOG(LogTemp, Error, TEXT("IK capture replay: could not read %s"), *capturePath);
+        return 1;
+    }
+
+    UE_LOG(
+        LogTemp, 
+        Display, 
+        TEXT("IK capture replay: %d frames, %d compared, %d mismatches (first %lld), max location error %.6f, max rotation error %.6f"),
+        report.NumFrames,
+        report.NumComparedFrames,
+        report.NumMismatches,
+        report.FirstMismatchFrame,
+        report.MaxLocationError,
+        report.MaxRotationError
+    );
+
+    return report.NumMismatches > 0 ? 1 : 0;
+}
@@ -3,10 +3,627 @@
 
 #include "Components/AnimInstances/BaseAnimInstance.h"
 
+#include "G_Lab.h"
 #include "GameFramework/Character.h"
-#include "Kismet/KismetMathLibrary.h"
+#include "Misc/Paths.h"
+#include "Components/AnimInstances/BaseAnimInstanceProxy.h"
+#include "Components/AnimInstances/IKCapture.h"
+#include "Components/AnimInstances/IKGroundQuery.h"
+#include "Components/AnimInstances/IKMath.h"
+#include "Components/AnimInstances/IKNavGroundProjection.h"
+#include "Entities/Characters/Base.h"
+#include "Subsystems/BaseAnimSharingSubsystem.h"
+#include "Subsystems/IKBudgetSubsystem.h"
+#include "Subsystems/IKContactSubsystem.h"
+#include "Subsystems/IKGroundQueryCache.h"
 
-#pragma optimize("", off)
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Sleeping Anim Instances"), STAT_GLab_SleepingAnimInstances, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Nav Fallbacks To Physics"), STAT_GLab_IKNavPhysicsFallbacks, STATGROUP_GLab);
+
+FAnimInstanceProxy* UBaseAnimInstance::CreateAnimInstanceProxy()
+{
+    return new FBaseAnimInstanceProxy(this);
+}
+
+void UBaseAnimInstance::NativeInitializeAnimation()
+{
+    Super::NativeInitializeAnimation();
+
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+    if (owner != this)
+    {
+        // Layers hand their IK setup over, keys the main instance already has keep its own settings
+        for (TPair<FName, FIKParams>& ik : this->IKParams)
+        {
+            if (owner->IKParams.Contains(ik.Key))
+            {
+                UE_LOG(LogTemp, Verbose, TEXT("IK settings: %s of layer %s discarded, %s already defines it"), 
+                    *ik.Key.ToString(), *GetNameSafe(this->GetClass()), *GetNameSafe(owner->GetClass()));
+                continue;
+            }
+
+            if (owner->IsCapturingIK())
+            {
+                UE_LOG(LogTemp, Warning, TEXT("IK capture: %s of layer %s linked after the capture opened, it is not recorded"), 
+                    *ik.Key.ToString(), *GetNameSafe(this->GetClass()));
+            }
+
+            owner->IKParams.Add(ik.Key, MoveTemp(ik.Value));
+        }
+
+        for (FIKRoots& root : this->IKRoots)
+        {
+            bool known = owner->IKRoots.ContainsByPredicate([&root](const FIKRoots& ownerRoot)
+            {
+                return ownerRoot.RootName == root.RootName;
+            });
+
+            if (!known)
+            {
+                owner->IKRoots.Add(MoveTemp(root));
+            }
+        }
+
+        owner->InvalidateIKComponentSpace();
+        owner->RefreshIKReplicationOrder();
+
+        this->IKParams.Empty();
+        this->IKRoots.Empty();
+        return;
+    }
+
+    this->RefreshIKQueryParams();
+    this->RefreshIKReplicationOrder();
+
+    UWorld* world = this->GetWorld();
+    UBaseAnimSharingSubsystem* sharing = world ? world->GetSubsystem<UBaseAnimSharingSubsystem>() : nullptr;
+    if (this->UseAnimationSharing && this->LocomotionCopiesSharedLeader && sharing)
+    {
+        sharing->Register(this);
+    }
+
+    UIKBudgetSubsystem* budget = world ? world->GetSubsystem<UIKBudgetSubsystem>() : nullptr;
+    if (this->UseIKBudget && budget)
+    {
+        budget->Register(this);
+        this->IKBudget = budget;
+    }
+
+    if (this->CaptureIKOnStart && world && world->IsGameWorld())
+    {
+        this->StartIKCapture(FString());
+    }
+
+    this->OnMontageStarted.AddUniqueDynamic(this, &UBaseAnimInstance::HandleMontageStarted);
+}
+
+void UBaseAnimInstance::NativeUninitializeAnimation()
+{
+    UWorld* world = this->GetWorld();
+    if (UBaseAnimSharingSubsystem* sharing = world ? world->GetSubsystem<UBaseAnimSharingSubsystem>() : nullptr)
+    {
+        sharing->Unregister(this);
+    }
+
+    if (UIKBudgetSubsystem* budget = this->IKBudget.Get())
+    {
+        budget->Unregister(this);
+        this->IKBudget.Reset();
+    }
+
+    this->StopIKCapture();
+
+    if (this->IsSleeping)
+    {
+        this->WakeFromSleep();
+    }
+
+    Super::NativeUninitializeAnimation();
+}
+
+void UBaseAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
+{
+    Super::NativeUpdateAnimation(DeltaSeconds);
+
+    if (this->IKCaptureWriter.IsValid())
+    {
+        this->IKCaptureWriter->FlushBuffered();
+    }
+
+    if (this->GetIKStateOwner() == this)
+    {
+        // IKParams is Blueprint writable, pick up keys added or removed outside of the layer merge
+        if (this->IKReplicationOrder.Num() != this->IKParams.Num())
+        {
+            this->RefreshIKReplicationOrder();
+        }
+
+        this->BatchProjectIKNavGround();
+    }
+
+    if (this->LinkedLayerStates.Num() > 0)
+    {
+        this->UpdateLinkedLayers();
+    }
+}
+
+UBaseAnimInstance* UBaseAnimInstance::GetIKStateOwner() const
+{
+    USkeletalMeshComponent* body = this->GetOwningComponent();
+    UBaseAnimInstance* mainInstance = body ? Cast<UBaseAnimInstance>(body->GetAnimInstance()) : nullptr;
+
+    if (!this->ShareIKStateWithMainInstance || !mainInstance)
+    {
+        return const_cast<UBaseAnimInstance*>(this);
+    }
+
+    return mainInstance;
+}
+
+void UBaseAnimInstance::ActivateLinkedLayer(TSubclassOf<UAnimInstance> layerClass)
+{
+    USkeletalMeshComponent* body = this->GetOwningComponent();
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+
+    if (owner != this)
+    {
+        owner->ActivateLinkedLayer(layerClass);
+        return;
+    }
+
+    if (!body || !layerClass)
+    {
+        return;
+    }
+
+    FBaseLinkedLayerState* layerState = this->LinkedLayerStates.FindByPredicate([layerClass](const FBaseLinkedLayerState& state)
+    {
+        return state.LayerClass == layerClass;
+    });
+
+    if (!layerState)
+    {
+        body->LinkAnimClassLayers(layerClass);
+
+        layerState = &this->LinkedLayerStates.AddDefaulted_GetRef();
+        layerState->LayerClass = layerClass;
+    }
+
+    layerState->Active = true;
+
+    if (UBaseAnimInstance* layer = Cast<UBaseAnimInstance>(this->GetLinkedAnimLayerInstanceByClass(layerClass)))
+    {
+        layer->IsLayerSuspended = false;
+    }
+}
+
+void UBaseAnimInstance::DeactivateLinkedLayer(TSubclassOf<UAnimInstance> layerClass)
+{
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+
+    if (owner != this)
+    {
+        owner->DeactivateLinkedLayer(layerClass);
+        return;
+    }
+
+    for (FBaseLinkedLayerState& layerState : this->LinkedLayerStates)
+    {
+        if (layerState.LayerClass != layerClass || !layerState.Active)
+        {
+            continue;
+        }
+
+        layerState.Active = false;
+        layerState.InactiveSince = this->GetWorld()->GetTimeSeconds();
+
+        if (UBaseAnimInstance* layer = Cast<UBaseAnimInstance>(this->GetLinkedAnimLayerInstanceByClass(layerClass)))
+        {
+            layer->IsLayerSuspended = true;
+        }
+    }
+}
+
+bool UBaseAnimInstance::IsLinkedLayerActive(TSubclassOf<UAnimInstance> layerClass) const
+{
+    const UBaseAnimInstance* owner = this->GetIKStateOwner();
+
+    return owner->LinkedLayerStates.ContainsByPredicate([layerClass](const FBaseLinkedLayerState& state)
+    {
+        return state.LayerClass == layerClass && state.Active;
+    });
+}
+
+void UBaseAnimInstance::UpdateLinkedLayers()
+{
+    USkeletalMeshComponent* body = this->GetOwningComponent();
+    double timeSeconds = this->GetWorld()->GetTimeSeconds();
+
+    for (int32 index = this->LinkedLayerStates.Num() - 1; index >= 0; index--)
+    {
+        const FBaseLinkedLayerState& layerState = this->LinkedLayerStates[index];
+
+        if (layerState.Active || timeSeconds - layerState.InactiveSince < this->SuspendedLayerUnlinkDelay)
+        {
+            continue;
+        }
+
+        if (body)
+        {
+            body->UnlinkAnimClassLayers(layerState.LayerClass);
+        }
+
+        this->LinkedLayerStates.RemoveAtSwap(index);
+    }
+}
+
+void UBaseAnimInstance::UpdateSettledSleep()
+{
+    USkeletalMeshComponent* body = this->GetOwningComponent();
+    AActor* owner = this->GetOwningActor();
+
+    if (!body || !owner || this->GetIKStateOwner() != this)
+    {
+        return;
+    }
+
+    if (!this->IsSleeping)
+    {
+        if (
+            this->UseSettledSleep
+            && this->IKExecutionContext == EIKExecutionContext::Full
+            && this->SettledFrames >= this->SettledFrameCount
+            && !this->IsSharedLocomotionLeader
+            && !this->IsAnyMontagePlaying()
+        ) {
+            this->EnterSettledSleep();
+        }
+
+        return;
+    }
+
+    bool moved = !this->UseSettledSleep
+            ||  (owner->GetVelocity() - this->VelocityAtSleep).Size() > this->IdleMoveThreshold
+            ||  !body->GetComponentTransform().Equals(this->MeshTransformAtSleep)
+            ||  this->IsAnyMontagePlaying()
+            ||  (!this->RenderedAtSleep && body->WasRecentlyRendered());
+
+    for (int32 index = 0; !moved && index < this->SleepGroundTransforms.Num(); index++)
+    {
+        const UPrimitiveComponent* groundComponent = this->SleepGroundTransforms[index].Key.Get();
+
+        moved = !groundComponent 
+            ||  !groundComponent->GetComponentTransform().Equals(this->SleepGroundTransforms[index].Value);
+    }
+
+    if (moved)
+    {
+        this->WakeFromSleep();
+    }
+}
+
+void UBaseAnimInstance::EnterSettledSleep()
+{
+    USkeletalMeshComponent* body = this->GetOwningComponent();
+
+    this->IsSleeping = true;
+    this->VelocityAtSleep = this->GetOwningActor()->GetVelocity();
+    this->MeshTransformAtSleep = body->GetComponentTransform();
+    this->RenderedAtSleep = body->WasRecentlyRendered();
+
+    this->SleepGroundTransforms.Reset();
+    for (const TPair<FName, FIKParams>& ik : this->IKParams)
+    {
+        if (UPrimitiveComponent* groundComponent = ik.Value.HitComponent.Get())
+        {
+            this->SleepGroundTransforms.Emplace(groundComponent, groundComponent->GetComponentTransform());
+        }
+    }
+
+    // The mesh keeps its last evaluated pose while it does not tick
+    if (this->SleepMode == EIKSleepMode::FreezePose)
+    {
+        body->SetComponentTickEnabled(false);
+    }
+    else
+    {
+        this->TickIntervalBeforeSleep = body->GetComponentTickInterval();
+        body->SetComponentTickInterval(this->SleepTickInterval);
+    }
+
+    INC_DWORD_STAT(STAT_GLab_SleepingAnimInstances);
+}
+
+void UBaseAnimInstance::WakeFromSleep()
+{
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+    if (owner != this)
+    {
+        owner->WakeFromSleep();
+        return;
+    }
+
+    this->SettledFrames = 0;
+
+    if (!this->IsSleeping)
+    {
+        return;
+    }
+
+    this->IsSleeping = false;
+    this->SleepGroundTransforms.Reset();
+
+    if (USkeletalMeshComponent* body = this->GetOwningComponent())
+    {
+        if (this->SleepMode == EIKSleepMode::FreezePose)
+        {
+            body->SetComponentTickEnabled(true);
+        }
+        else
+        {
+            body->SetComponentTickInterval(this->TickIntervalBeforeSleep);
+        }
+    }
+
+    DEC_DWORD_STAT(STAT_GLab_SleepingAnimInstances);
+}
+
+void UBaseAnimInstance::HandleMontageStarted(UAnimMontage* montage)
+{
+    this->WakeFromSleep();
+}
+
+bool UBaseAnimInstance::StartIKCapture(const FString& filePath)
+{
+    FString capturePath = filePath;
+    if (capturePath.IsEmpty())
+    {
+        capturePath = FPaths::Combine(
+                FPaths::ProjectSavedDir()
+            ,   TEXT("IKCaptures")
+            ,   FString::Printf(TEXT("%s_%s.ikcap"), *GetNameSafe(this->GetOwningActor()), *FDateTime::Now().ToString())
+        );
+    }
+
+    this->IKCaptureWriter = MakeShared<FIKCaptureWriter>();
+
+    if (!this->IKCaptureWriter->Open(capturePath, *this))
+    {
+        this->IKCaptureWriter.Reset();
+        return false;
+    }
+
+    UE_LOG(LogTemp, Log, TEXT("IK capture: writing %s"), *capturePath);
+    return true;
+}
+
+void UBaseAnimInstance::StopIKCapture()
+{
+    this->IKCaptureWriter.Reset();
+}
+
+bool UBaseAnimInstance::IsCapturingIK() const
+{
+    return this->IKCaptureWriter.IsValid();
+}
+
+bool UBaseAnimInstance::IsSharedLocomotionFollower() const
+{
+    return this->SharedLocomotionLeader != nullptr;
+}
+
+void UBaseAnimInstance::SetSharedLocomotionLeader(USkeletalMeshComponent* leader, bool leadsFollowers)
+{
+    USkeletalMeshComponent* body = this->GetOwningComponent();
+
+    if (!body)
+    {
+        return;
+    }
+
+    // Followers tick after their leader so the copied pose is from the same frame
+    if (this->SharedLocomotionLeader && this->SharedLocomotionLeader != leader)
+    {
+        body->RemoveTickPrerequisiteComponent(this->SharedLocomotionLeader);
+    }
+
+    if (leader && this->SharedLocomotionLeader != leader)
+    {
+        body->AddTickPrerequisiteComponent(leader);
+    }
+
+    this->SharedLocomotionLeader = leader;
+
+    // Leaders keep evaluating while culled, their followers may still be on screen
+    if (leadsFollowers && !this->IsSharedLocomotionLeader)
+    {
+        this->VisibilityBasedAnimTickOptionBeforeLeading = body->VisibilityBasedAnimTickOption;
+        body->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPose;
+    }
+    else if (!leadsFollowers && this->IsSharedLocomotionLeader)
+    {
+        body->VisibilityBasedAnimTickOption = this->VisibilityBasedAnimTickOptionBeforeLeading;
+    }
+
+    this->IsSharedLocomotionLeader = leadsFollowers;
+}
+
+void UBaseAnimInstance::RefreshIKQueryParams()
+{
+    AActor* owner = this->GetOwningActor();
+
+    TArray<AActor*> ignoredActors;
+    if (owner)
+    {
+        owner->GetAttachedActors(ignoredActors, true, true);
+        ignoredActors.Add(owner);
+    }
+
+    for (AActor* ignoredActor : this->IKIgnoredActors)
+    {
+        if (ignoredActor)
+        {
+            ignoredActors.AddUnique(ignoredActor);
+        }
+    }
+
+    this->IKQueryParams.Build(this->IKGroundChannel, ignoredActors);
+
+    UWorld* world = this->GetWorld();
+    this->IKQueryParams.Cache = this->UseSharedGroundQueryCache && world ?
+            world->GetSubsystem<UIKGroundQueryCache>()
+        :   nullptr;
+}
+
+EIKExecutionContext UBaseAnimInstance::ResolveIKExecutionContext() const
+{
+    UWorld* world = this->GetWorld();
+
+    if (IsRunningDedicatedServer() || (world && world->GetNetMode() == NM_DedicatedServer))
+    {
+        ABase* character = Cast<ABase>(this->GetOwningActor());
+        bool replicatesContacts = character && character->ReplicateIKContacts;
+
+        return this->DedicatedServerIKMode == EIKServerMode::ContactOnly || replicatesContacts ?
+                EIKExecutionContext::ContactOnly
+            :   EIKExecutionContext::Skipped;
+    }
+
+    USkeletalMeshComponent* body = this->GetOwningComponent();
+
+    if (
+        !this->SkipIKWhenNotRendered 
+        || !body 
+        || body->VisibilityBasedAnimTickOption == EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones
+        || body->WasRecentlyRendered()
+    ) {
+        return EIKExecutionContext::Full;
+    }
+
+    // Bones are not refreshed while culled, only keep what audio and gameplay still need
+    return this->PublishContactEvents ? 
+            EIKExecutionContext::ContactOnly 
+        :   EIKExecutionContext::Skipped;
+}
+
+EIKGroundSource UBaseAnimInstance::GetActiveIKGroundSource() const
+{
+    if (this->IKGroundSource == EIKGroundSource::NavMesh)
+    {
+        return EIKGroundSource::NavMesh;
+    }
+
+    USkeletalMeshComponent* body = this->GetOwningComponent();
+    if (
+        this->NavMeshGroundSourceMinLOD != INDEX_NONE
+        && body
+        && body->GetPredictedLODLevel() >= this->NavMeshGroundSourceMinLOD
+    ) {
+        return EIKGroundSource::NavMesh;
+    }
+
+    return EIKGroundSource::Physics;
+}
+
+bool UBaseAnimInstance::TraceIKGround(const FIKParams& ikParams, const FVector& startTrace, FHitResult& traceResult) const
+{
+    UWorld* world = this->GetWorld();
+
+    ABase* character = Cast<ABase>(this->GetOwningActor());
+    // Only the solve knows which replicated foot it is tracing, other callers trace for real
+    if (
+        character 
+        && character->UsesReplicatedIKContacts() 
+        && this->SolvingIKIndex != INDEX_NONE 
+        && this->SolvingIKIndex < FIKContactSummary::MaxFeet
+    ) {
+        return this->TraceReplicatedIKGround(*character, this->SolvingIKIndex, ikParams, startTrace, traceResult);
+    }
+
+    // The batch is projected on the game thread before the update, the solve on anim workers only reads it
+    if (this->GetActiveIKGroundSource() == EIKGroundSource::NavMesh)
+    {
+        bool batched = this->NavGroundQueries.IsValidIndex(this->SolvingIKIndex)
+                    && this->NavGroundQueries[this->SolvingIKIndex].StartTrace.Equals(startTrace);
+
+        if (batched && this->NavGroundQueries[this->SolvingIKIndex].Hitted)
+        {
+            FIKNavGroundProjection::BuildHitResult(this->NavGroundQueries[this->SolvingIKIndex], traceResult);
+            return true;
+        }
+
+        // Recast is not safe to query while tiles rebuild, unbatched traces on anim workers go to physics
+        if (!batched && !IsInGameThread())
+        {
+            INC_DWORD_STAT(STAT_GLab_IKNavPhysicsFallbacks);
+        }
+        else if (
+            !batched
+            && FIKNavGroundProjection::Project(
+                    world
+                ,   startTrace
+                ,   ikParams.TraceDirection
+                ,   ikParams.TraceLength
+                ,   ikParams.TraceRadius
+                ,   this->NavMeshMaxSurfaceAngle
+                ,   traceResult
+            )
+        ) {
+            return true;
+        }
+    }
+
+    EIKGroundQueryMode queryMode = this->IKExecutionContext == EIKExecutionContext::ContactOnly ?
+            EIKGroundQueryMode::Line
+        :   ikParams.GroundQueryMode;
+
+    return FIKGroundQuery::Trace(
+            world
+        ,   ikParams
+        ,   startTrace
+        ,   ikParams.ImpactPoint
+        ,   queryMode
+        ,   this->IKQueryParams
+        ,   traceResult
+    );
+}
+
+bool UBaseAnimInstance::TraceReplicatedIKGround(
+        const ABase& character
+    ,   int32 footIndex
+    ,   const FIKParams& ikParams
+    ,   const FVector& startTrace
+    ,   FHitResult& traceResult
+) const
+{
+    float impactHeight = 0;
+    FVector3f impactNormal = FVector3f::UpVector;
+    if (!character.GetReplicatedIKContact(footIndex, impactHeight, impactNormal))
+    {
+        return false;
+    }
+
+    // Keep the local foot position on the ground plane, only the height and normal come from the authority
+    FVector3f componentImpact = IKMath::ToComponentSpace(this->IKComponentTransform, startTrace);
+    componentImpact.Z = impactHeight;
+
+    FVector impactPoint = this->IKComponentTransform.TransformPosition(FVector(componentImpact));
+    FVector normal = this->IKComponentTransform.TransformVector(FVector(impactNormal));
+
+    traceResult = FHitResult(startTrace, startTrace + (ikParams.TraceDirection * ikParams.TraceLength));
+    traceResult.bBlockingHit = true;
+    traceResult.Location = impactPoint;
+    traceResult.ImpactPoint = impactPoint;
+    traceResult.Normal = normal;
+    traceResult.ImpactNormal = normal;
+    traceResult.Distance = FVector::DotProduct(impactPoint - startTrace, ikParams.TraceDirection);
+
+    return true;
+}
+
+#if G_LAB_IK_DEOPTIMIZE
+UE_DISABLE_OPTIMIZATION
+#endif
 FIKData UBaseAnimInstance::GetIKData(const FIKParams& ikParams, bool& hitted)
 {
     
@@ -20,7 +637,7 @@ FIKData UBaseAnimInstance::GetIKData(const FIKParams& ikParams, bool& hitted)
             this->GetCurveValue(ikParams.WeightCurveName) 
         :   ikParams.Weight;
 
-    UE_LOG(LogTemp, Log, TEXT("WEIGHT:%.2f"), currentWeight);
+    UE_LOG(LogTemp, VeryVerbose, TEXT("WEIGHT:%.2f"), currentWeight);
     
     bool getLockWeightByCurve = ikParams.LockWeightCurveName.IsValid() 
                             &&  !ikParams.LockWeightCurveName.IsNone()
@@ -30,154 +647,459 @@ FIKData UBaseAnimInstance::GetIKData(const FIKParams& ikParams, bool& hitted)
         :   ikParams.LockWeight;
 
 
-    /**********************
-    * CALCULATE START TRACE
-    ***********************/
-    FVector startTrace = FVector::Zero();
-    FVector startReference = FVector::Zero();
-    if (ikParams.StartTraceBoneReference.IsValid() && ikParams.StartTraceBoneReference.GetStringLength() > 0) 
+    /**********************
+    * CALCULATE START TRACE
+    ***********************/
+    FVector startReference = FVector::Zero();
+    FVector startTrace = this->ResolveIKStartTrace(ikParams, startReference);
+
+    /*****************
+    * FIND IK LOCATION
+    ******************/
+    FHitResult traceResult;
+    hitted = this->TraceIKGround(ikParams, startTrace, traceResult);
+
+    if (hitted) 
+    {
+        // Only the hit is rebased, the lock is solved relative to the mesh in floats
+        FVector3f componentLocation = IKMath::ResolveComponentIKLocation(
+                IKMath::ToComponentSpace(this->IKComponentTransform, traceResult.ImpactPoint)
+            ,   ikParams.ComponentLockLocation
+            ,   IKMath::ToComponentDirection(this->IKComponentTransform, ikParams.TraceDirection)
+            ,   ikParams.Padding
+            ,   currentLockWeight
+        );
+        FVector ikLocation = this->IKComponentTransform.TransformPosition(FVector(componentLocation));
+
+        if (
+            !ikParams.AlignEffectorBoneToSurface 
+            || this->IKExecutionContext == EIKExecutionContext::ContactOnly
+            || this->IKQualityTier == EIKQualityTier::FeetOnly
+        ) 
+        {
+            FIKData ikData(
+                    currentWeight
+                ,   startReference
+                ,   traceResult.Normal
+                ,   ikLocation
+            );
+            ikData.LockWeight = currentLockWeight;
+            ikData.ImpactPoint = traceResult.ImpactPoint;
+            ikData.ComponentLocation = componentLocation;
+            ikData.HitComponent = traceResult.GetComponent();
+
+            return ikData;
+        }
+
+        FRotator effectorBoneAdditiveRotation = IKMath::ResolveSurfaceAlignment(ikParams, traceResult.Normal);
+
+        float rotationWeight = this->GetCurveValue(ikParams.WeightRotationCurveName);
+     
+        FIKData ikData(
+                currentWeight
+            ,   startReference
+            ,   traceResult.Normal
+            ,   ikLocation
+            ,   effectorBoneAdditiveRotation
+            ,   rotationWeight
+        );
+        ikData.LockWeight = currentLockWeight;
+        ikData.ImpactPoint = traceResult.ImpactPoint;
+        ikData.ComponentLocation = componentLocation;
+        ikData.HitComponent = traceResult.GetComponent();
+
+        return ikData;
+    }
+
+    return FIKData();
+}
+#if G_LAB_IK_DEOPTIMIZE
+UE_ENABLE_OPTIMIZATION
+#endif
+
+#if G_LAB_IK_DEOPTIMIZE
+UE_DISABLE_OPTIMIZATION
+#endif
+TArray<FIKParams> UBaseAnimInstance::UpdateIKs()
+{
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+
+    if (owner != this)
+    {
+        return this->IsLayerSuspended || owner->SolveIKsOnce() ? owner->GetIKParamsValues() : TArray<FIKParams>();
+    }
+
+    if (!this->SolveIKsOnce())
+    {
+        return TArray<FIKParams>();
+    }
+
+    return this->GetIKParamsValues();
+}
+
+void UBaseAnimInstance::UpdateIKsThreadSafe()
+{
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+
+    if (owner != this)
+    {
+        if (!this->IsLayerSuspended)
+        {
+            owner->SolveIKsOnce();
+        }
+
+        return;
+    }
+
+    this->SolveIKsOnce();
+}
+
+bool UBaseAnimInstance::SolveIKsOnce()
+{
+    if (this->LastIKSolveFrame == GFrameCounter)
+    {
+        return this->LastIKSolveResult;
+    }
+
+    this->LastIKSolveFrame = GFrameCounter;
+    this->LastIKSolveResult = this->SolveIKs();
+
+    return this->LastIKSolveResult;
+}
+
+bool UBaseAnimInstance::SolveIKs()
+{
+    ACharacter* character = Cast<ACharacter>( this->GetOwningActor() );
+
+    if (!character) 
+    {
+        return false;
+    }
+
+    // Targets are settled, the last solve is kept until UpdateSettledSleep wakes the instance
+    if (this->IsSleeping)
+    {
+        return true;
+    }
+
+    this->IKExecutionContext = this->ResolveIKExecutionContext();
+
+    if (this->IKExecutionContext == EIKExecutionContext::Skipped)
+    {
+        this->SettledFrames = 0;
+        return true;
+    }
+
+    bool contactOnly = this->IKExecutionContext == EIKExecutionContext::ContactOnly;
+
+    // Contact events still need the solve, the budget only trades visual quality
+    EIKQualityTier qualityTier = contactOnly ? EIKQualityTier::Full : this->IKQualityTier;
+
+    if (qualityTier == EIKQualityTier::Cached)
     {
-        startReference = this->GetOwningComponent()->GetSocketLocation(ikParams.StartTraceBoneReference) * ikParams.StartTraceMask;
-        startTrace = FVector(startReference);
+        return true;
+    }
 
-        if (ikParams.AddRelativeLocationFromReverseMask) 
+    // Weight doubles as the configured constant of IKs without curves, it is put back once the tier rises
+    if (qualityTier == EIKQualityTier::Off)
+    {
+        for (TPair<FName, FIKParams>& ik : this->IKParams)
         {
-            FVector reverseMask = FVector(1) - ikParams.StartTraceMask;
-            startTrace += reverseMask * ikParams.ReverseMaskStartTraceLocation;
+            if (!this->WeightsBeforeOff.Contains(ik.Key))
+            {
+                this->WeightsBeforeOff.Add(ik.Key, FVector2f(ik.Value.Weight, ik.Value.RotationWeight));
+            }
+
+            ik.Value.Weight = 0;
+            ik.Value.RotationWeight = 0;
         }
+
+        return true;
     }
-    else 
+
+    for (const TPair<FName, FVector2f>& weights : this->WeightsBeforeOff)
     {
-        startTrace = ikParams.StartTraceLocation;
+        if (FIKParams* ikParams = this->IKParams.Find(weights.Key))
+        {
+            ikParams->Weight = weights.Value.X;
+            ikParams->RotationWeight = weights.Value.Y;
+        }
     }
 
-    /*****************
-    * FIND IK LOCATION
-    ******************/
-    FHitResult traceResult;
-    FCollisionQueryParams params;
+    this->WeightsBeforeOff.Reset();
+
+    uint64 startCycles = FPlatformTime::Cycles64();
+
+    this->UpdateIKComponentSpace();
+
+    if (this->IKCaptureWriter.IsValid())
+    {
+        this->IKCaptureWriter->BeginFrame(*this);
+    }
     
-    hitted = this->GetWorld()->SweepSingleByChannel(
-        traceResult,
-        startTrace,
-        startTrace + ( ikParams.TraceDirection * ikParams.TraceLength ),
-        FQuat::Identity,
-        ECollisionChannel::ECC_Visibility,
-        FCollisionShape::MakeSphere(ikParams.TraceRadius),
-        params
-    );
+    const TArray<FName>& iks = this->GetIKNamesInReplicationOrder();
 
-    if (hitted) 
+    float maxTargetDelta = 0;
+
+    for (int32 ikIndex = 0; ikIndex < iks.Num(); ikIndex++) 
     {
-        FVector ikLocation = FMath::Lerp( 
-                traceResult.ImpactPoint + ((ikParams.TraceDirection * -1) * ikParams.Padding)
-            ,   ikParams.CurrentLockLocation
-            ,   currentLockWeight
+        FName currentIk = iks[ikIndex];
+        bool hitted = false;
+        
+        this->SolvingIKIndex = ikIndex;
+        FIKData ik = this->GetIKData(this->IKParams[currentIk], hitted);
+        maxTargetDelta = FMath::Max(
+                maxTargetDelta
+            ,   FVector3f::Dist(ik.ComponentLocation, this->IKParams[currentIk].ComponentLockLocation)
         );
+        this->IKParams[currentIk].StartReferenceLocation = ik.StartReferenceLocation;
+        this->IKParams[currentIk].Hitted = hitted;
+        this->IKParams[currentIk].CurrentLockWeight = ik.LockWeight;
 
-        if (!ikParams.AlignEffectorBoneToSurface) 
+        // A miss keeps the last ground, the lift event and later rebases start from where the foot left
+        if (hitted)
         {
-            return FIKData(
-                    currentWeight
-                ,   startReference
-                ,   traceResult.Normal
-                ,   ikLocation
-            );
+            this->IKParams[currentIk].CurrentLockLocation = ik.Location;
+            this->IKParams[currentIk].ComponentLockLocation = ik.ComponentLocation;
+            this->IKParams[currentIk].HitNormal = ik.Normal;
+            this->IKParams[currentIk].ImpactPoint = ik.ImpactPoint;
+            this->IKParams[currentIk].HitComponent = ik.HitComponent;
         }
 
-        float asideAlignment = UKismetMathLibrary::DegAtan2(traceResult.Normal.Y, traceResult.Normal.Z);
-        float forwardAlignment = UKismetMathLibrary::DegAtan2(traceResult.Normal.X, traceResult.Normal.Z) * -1;
+        bool planted = hitted && ik.LockWeight >= this->IKParams[currentIk].PlantLockWeightThreshold;
+        if (planted != this->IKParams[currentIk].Planted)
+        {
+            this->IKParams[currentIk].Planted = planted;
+            this->PublishContactEvent(currentIk, this->IKParams[currentIk]);
+        }
 
-        FRotator effectorBoneAdditiveRotation = FRotator(
-                forwardAlignment + ikParams.EffectorAddtiveRotationOffset.Pitch
-            ,   0
-            ,   asideAlignment + ikParams.EffectorAddtiveRotationOffset.Roll);
+        if (contactOnly)
+        {
+            continue;
+        }
 
-        float rotationWeight = this->GetCurveValue(ikParams.WeightRotationCurveName);
-     
-        return FIKData(
-                currentWeight
-            ,   startReference
-            ,   traceResult.Normal
-            ,   ikLocation
-            ,   effectorBoneAdditiveRotation
-            ,   rotationWeight
-        );
+        this->IKParams[currentIk].EffectorAddtiveRotation = ik.Rotation;
+        this->IKParams[currentIk].Weight = ik.Weight;
+        this->IKParams[currentIk].RotationWeight = ik.RotationWeight;
+
+        if (hitted)
+        {
+            this->IKParams[currentIk].FinalIKLocation = FVector(ik.ComponentLocation);
+        }
     }
 
-    return FIKData();
+    this->SolvingIKIndex = INDEX_NONE;
+
+    // The replicated summary carries the root offsets, contact only authorities still resolve them
+    ABase* base = Cast<ABase>(character);
+    bool sendsRootOffsets = contactOnly && base && base->ReplicateIKContacts && base->HasAuthority();
+
+    if (!contactOnly && qualityTier == EIKQualityTier::FeetOnly)
+    {
+        for (FIKRoots& currentRoot : this->IKRoots)
+        {
+            currentRoot.RootShouldDealocate = false;
+        }
+    }
+    else if (!contactOnly)
+    {
+        this->UpdateRoots();
+
+        if (this->IsTransitioning) 
+        {
+            this->InterpolateIKTransition();
+        }
+    }
+    else if (sendsRootOffsets)
+    {
+        this->UpdateRoots();
+    }
+
+    // Contact only solves skip the visual targets, a pose settled off screen is not one to freeze
+    bool settled = !contactOnly
+                && !this->IsTransitioning
+                && this->IKTransitionInitialLocation.Num() == 0
+                && character->GetVelocity().Size() < this->IdleMoveThreshold
+                && maxTargetDelta < this->SettledTargetTolerance;
+
+    if (settled)
+    {
+        this->SettledFrames++;
+    }
+    else
+    {
+        this->SettledFrames = 0;
+    }
+
+    // Contact only solves are outside of the budget, they would drag the full tier cost down
+    UIKBudgetSubsystem* budget = this->IKBudget.Get();
+    if (budget && !contactOnly)
+    {
+        budget->ReportCost(qualityTier, FPlatformTime::Cycles64() - startCycles);
+    }
+
+    if (this->IKCaptureWriter.IsValid())
+    {
+        this->IKCaptureWriter->EndFrame(*this, this->GetWorld()->GetDeltaSeconds());
+    }
+
+    return true;
+
 }
-#pragma optimize("", on)
 
-#pragma optimize("", off)
-TArray<FIKParams> UBaseAnimInstance::UpdateIKs()
+void UBaseAnimInstance::UpdateIKComponentSpace()
 {
-    ACharacter* character = Cast<ACharacter>( this->GetOwningActor() );
+    USkeletalMeshComponent* body = this->GetOwningComponent();
+    FTransform componentTransform(body->GetComponentQuat(), body->GetComponentLocation());
 
-    if (!character) 
+    if (this->IKComponentSpaceValid)
     {
-        return TArray<FIKParams>();
+        // One double precision rebase per frame carries the locks over the mesh movement
+        FTransform3f rebase(this->IKComponentTransform.GetRelativeTransform(componentTransform));
+
+        for (TPair<FName, FIKParams>& ik : this->IKParams)
+        {
+            ik.Value.ComponentLockLocation = rebase.TransformPosition(ik.Value.ComponentLockLocation);
+        }
     }
-    
-    TArray<FName> iks;
-    this->IKParams.GetKeys(iks);
+    else
+    {
+        for (TPair<FName, FIKParams>& ik : this->IKParams)
+        {
+            ik.Value.ComponentLockLocation = IKMath::ToComponentSpace(componentTransform, ik.Value.CurrentLockLocation);
+        }
+
+        this->IKComponentSpaceValid = true;
+    }
+
+    this->IKComponentTransform = componentTransform;
+}
+
+const TArray<FName>& UBaseAnimInstance::GetIKNamesInReplicationOrder() const
+{
+    return this->IKReplicationOrder;
+}
+
+void UBaseAnimInstance::RefreshIKReplicationOrder()
+{
+    this->IKParams.GetKeys(this->IKReplicationOrder);
+    this->IKReplicationOrder.Sort(FNameLexicalLess());
+}
 
-    for (FName currentIk : iks) 
+FVector UBaseAnimInstance::ResolveIKStartTrace(const FIKParams& ikParams, FVector& startReference) const
+{
+    if (ikParams.StartTraceBoneReference.IsValid() && ikParams.StartTraceBoneReference.GetStringLength() > 0) 
     {
-        bool hitted = false;
-        
-        FIKData ik = this->GetIKData(this->IKParams[currentIk], hitted);
-        this->IKParams[currentIk].StartReferenceLocation = ik.StartReferenceLocation;
-        this->IKParams[currentIk].CurrentLockLocation = ik.Location;
-        this->IKParams[currentIk].HitNormal = ik.Normal;
-        this->IKParams[currentIk].EffectorAddtiveRotation = ik.Rotation;
-        this->IKParams[currentIk].Hitted = hitted;
-        this->IKParams[currentIk].Weight = ik.Weight;
-        this->IKParams[currentIk].RotationWeight = ik.RotationWeight;
-        this->IKParams[currentIk].FinalIKLocation = this->GetRelativeIKLocation(
-            this->IKParams[currentIk].CurrentLockLocation
+        return IKMath::ResolveStartTrace(
+                ikParams
+            ,   this->GetOwningComponent()->GetSocketLocation(ikParams.StartTraceBoneReference)
+            ,   startReference
         );
     }
 
-    this->UpdateRoots();
+    return ikParams.StartTraceLocation;
+}
+
+void UBaseAnimInstance::BatchProjectIKNavGround()
+{
+    this->NavGroundQueries.Reset();
+
+    ABase* character = Cast<ABase>(this->GetOwningActor());
+    if (
+        this->GetActiveIKGroundSource() != EIKGroundSource::NavMesh
+        || this->IsSleeping
+        || (character && character->UsesReplicatedIKContacts())
+    ) {
+        return;
+    }
+
+    for (FName currentIk : this->GetIKNamesInReplicationOrder())
+    {
+        const FIKParams& ikParams = this->IKParams[currentIk];
+
+        FVector startReference;
+        FIKNavGroundQuery& query = this->NavGroundQueries.AddDefaulted_GetRef();
+        query.StartTrace = this->ResolveIKStartTrace(ikParams, startReference);
+        query.TraceDirection = ikParams.TraceDirection;
+        query.TraceLength = ikParams.TraceLength;
+        query.TraceRadius = ikParams.TraceRadius;
+    }
+
+    FIKNavGroundProjection::ProjectBatch(this->GetWorld(), this->NavGroundQueries, this->NavMeshMaxSurfaceAngle);
+}
+
+void UBaseAnimInstance::InvalidateIKComponentSpace()
+{
+    this->IKComponentSpaceValid = false;
+}
+
+void UBaseAnimInstance::PublishContactEvent(FName ikName, const FIKParams& ikParams)
+{
+    if (!this->PublishContactEvents)
+    {
+        return;
+    }
 
+    UWorld* world = this->GetWorld();
+    UIKContactSubsystem* contacts = world ? world->GetSubsystem<UIKContactSubsystem>() : nullptr;
 
-    if (this->IsTransitioning) 
+    if (!contacts)
     {
-        this->InterpolateIKTransition();
+        return;
     }
 
-    return this->GetIKParamsValues();
+    FIKContactEvent contactEvent;
+    contactEvent.Type = ikParams.Planted ? EIKContactEventType::Plant : EIKContactEventType::Lift;
+    contactEvent.IKName = ikName;
+    contactEvent.Owner = this->GetOwningActor();
+    contactEvent.HitComponent = ikParams.HitComponent;
+    contactEvent.Location = ikParams.CurrentLockLocation;
+    contactEvent.HitNormal = ikParams.HitNormal;
+    contactEvent.TimeSeconds = world->GetTimeSeconds();
 
+    contacts->Publish(contactEvent);
 }
 
 void UBaseAnimInstance::UpdateRoots()
 {
     USkeletalMeshComponent* body = this->GetOwningComponent();
 
+    ABase* character = Cast<ABase>(this->GetOwningActor());
+    if (character && character->UsesReplicatedIKContacts())
+    {
+        for (int32 rootIndex = 0; rootIndex < this->IKRoots.Num(); rootIndex++)
+        {
+            float rootOffset = character->GetReplicatedIKRootOffset(rootIndex);
+
+            this->IKRoots[rootIndex].RootShouldDealocate = !FMath::IsNearlyZero(rootOffset);
+            this->IKRoots[rootIndex].RootLocation = FVector(0, 0, rootOffset);
+        }
+
+        return;
+    }
+
     for (FIKRoots& currentRoot : this->IKRoots)
     {
         currentRoot.RootShouldDealocate = false;
 
         FVector rootLocation = body->GetSocketLocation(currentRoot.RootReference);
+        FVector3f componentRootLocation = IKMath::ToComponentSpace(this->IKComponentTransform, rootLocation);
 
-        float excedingDealocation = 0;
-        FVector directionDealocation = FVector::Zero();
-
+        TArray<const FIKParams*, TInlineAllocator<4>> childIKs;
         for (FName childIK : currentRoot.ChildIKs)
         {
-            FVector ikDealocation = this->IKParams[childIK].CurrentLockLocation - rootLocation;
-
-            float currentExcedingDealocation = ikDealocation.Length() - this->IKParams[childIK].MaxLength;
-
-            if (currentExcedingDealocation > 0 && currentExcedingDealocation > excedingDealocation)
-            {
-                excedingDealocation = currentExcedingDealocation;
-                directionDealocation = this->IKParams[childIK].TraceDirection;
-                currentRoot.RootShouldDealocate = true;
-            }
+            childIKs.Add(&this->IKParams[childIK]);
         }
 
+        float excedingDealocation = 0;
+        FVector directionDealocation = FVector::Zero();
+        currentRoot.RootShouldDealocate = IKMath::ResolveRootDislocation(
+                componentRootLocation
+            ,   childIKs
+            ,   directionDealocation
+            ,   excedingDealocation
+        );
+
         if (currentRoot.RootShouldDealocate)
         {
             //TODO: IMPLEMENT OBTAIN OF WEIGHT WITHOUT CURVES
@@ -187,32 +1109,38 @@ void UBaseAnimInstance::UpdateRoots()
 
             currentRoot.RootLocation = additionalRootDealocation;
 
-            DrawDebugSphere(
-                this->GetWorld(),
-                currentRoot.RootLocation + rootLocation,
-                12,
-                12,
-                FColor::Purple
-            );
+#if ENABLE_DRAW_DEBUG
+            if (IsInGameThread())
+            {
+                DrawDebugSphere(
+                    this->GetWorld(),
+                    currentRoot.RootLocation + rootLocation,
+                    12,
+                    12,
+                    FColor::Purple
+                );
+            }
+#endif
         }
 
         FVector greaterDealocation = FVector::Zero();
     }
 }
 
-#pragma optimize("", on)
-void UBaseAnimInstance::UpdateVelocityStats()
+#if G_LAB_IK_DEOPTIMIZE
+UE_ENABLE_OPTIMIZATION
+#endif
+void FBaseVelocityStats::Update(const FVector& velocity, float idleMoveThreshold)
 {
-    FVector currrentVelocity    = this->GetOwningActor()->GetVelocity();
-    FVector horizontalVelocity  = FVector(currrentVelocity.X, currrentVelocity.Y, 0);
+    FVector horizontalVelocity  = FVector(velocity.X, velocity.Y, 0);
     float currentAcceleration   = horizontalVelocity.Length() - this->LastVelocity.Length();
 
-    this->IsDecelerating        = currentAcceleration < ( this->IdleMoveThreshold * -1 );
-    this->IsAccelerating        = currentAcceleration > this->IdleMoveThreshold;
+    this->IsDecelerating        = currentAcceleration < ( idleMoveThreshold * -1 );
+    this->IsAccelerating        = currentAcceleration > idleMoveThreshold;
 
     if (!this->IsStopping && this->IsDecelerating)
     {
-        this->IsStopping = this->GetOwningActor()->GetVelocity().Length() < this->IdleMoveThreshold;
+        this->IsStopping = velocity.Length() < idleMoveThreshold;
     }
 
     if (this->IsAccelerating)
@@ -223,13 +1151,152 @@ void UBaseAnimInstance::UpdateVelocityStats()
     this->LastVelocity = horizontalVelocity;
 }
 
+void UBaseAnimInstance::UpdateVelocityStats()
+{
+    if (this->ComputeVelocityStatsInProxy)
+    {
+        return;
+    }
+
+    FBaseVelocityStats velocityStats = this->GetInstanceVelocityStats();
+    velocityStats.Update(this->GetOwningActor()->GetVelocity(), this->IdleMoveThreshold);
+    this->SetInstanceVelocityStats(velocityStats);
+}
+
+FBaseVelocityStats UBaseAnimInstance::GetVelocityStats() const
+{
+    if (!this->ComputeVelocityStatsInProxy)
+    {
+        return this->GetInstanceVelocityStats();
+    }
+
+    return this->GetProxyOnAnyThread<FBaseAnimInstanceProxy>().VelocityStats;
+}
+
+FBaseVelocityStats UBaseAnimInstance::GetInstanceVelocityStats() const
+{
+    FBaseVelocityStats velocityStats;
+    velocityStats.IsStopping = this->IsStopping;
+    velocityStats.IsDecelerating = this->IsDecelerating;
+    velocityStats.IsAccelerating = this->IsAccelerating;
+    velocityStats.LastVelocity = this->LastVelocity;
+
+    return velocityStats;
+}
+
+void UBaseAnimInstance::SetInstanceVelocityStats(const FBaseVelocityStats& velocityStats)
+{
+    this->IsStopping = velocityStats.IsStopping;
+    this->IsDecelerating = velocityStats.IsDecelerating;
+    this->IsAccelerating = velocityStats.IsAccelerating;
+    this->LastVelocity = velocityStats.LastVelocity;
+}
+
 void UBaseAnimInstance::UpdateReverseMaskStartTraceLocation(FName ikName,FVector newLocation)
 {
-    this->IKParams[ikName].ReverseMaskStartTraceLocation = newLocation;
+    this->GetIKStateOwner()->IKParams[ikName].ReverseMaskStartTraceLocation = newLocation;
+}
+
+FIKHandle UBaseAnimInstance::GetIKHandle(FName ikName) const
+{
+    const UBaseAnimInstance* owner = this->GetIKStateOwner();
+    if (owner != this)
+    {
+        return owner->GetIKHandle(ikName);
+    }
+
+    FIKHandle handle;
+    handle.IKName = ikName;
+
+    FSetElementId elementId = this->IKParams.FindId(ikName);
+    if (elementId.IsValidId())
+    {
+        handle.Index = elementId.AsInteger();
+    }
+
+    return handle;
+}
+
+const FIKParams* UBaseAnimInstance::FindIKParams(const FIKHandle& handle) const
+{
+    const UBaseAnimInstance* owner = this->GetIKStateOwner();
+    if (owner != this)
+    {
+        return owner->FindIKParams(handle);
+    }
+
+    // Element ids are sparse, holes left by removals are rejected before reading, the name guards stale handles
+    FSetElementId elementId = FSetElementId::FromInteger(handle.Index);
+    if (!handle.IsValid() || handle.Index >= this->IKParams.GetMaxIndex() || !this->IKParams.IsValidId(elementId))
+    {
+        return nullptr;
+    }
+
+    const TPair<FName, FIKParams>& ik = this->IKParams.Get(elementId);
+
+    return ik.Key == handle.IKName ? &ik.Value : nullptr;
+}
+
+FVector UBaseAnimInstance::GetIKFinalLocation(const FIKHandle& handle) const
+{
+    const FIKParams* ikParams = this->FindIKParams(handle);
+    return ikParams ? ikParams->FinalIKLocation : FVector::Zero();
+}
+
+FRotator UBaseAnimInstance::GetIKEffectorRotation(const FIKHandle& handle) const
+{
+    const FIKParams* ikParams = this->FindIKParams(handle);
+    return ikParams ? ikParams->EffectorAddtiveRotation : FRotator::ZeroRotator;
+}
+
+float UBaseAnimInstance::GetIKWeight(const FIKHandle& handle) const
+{
+    const FIKParams* ikParams = this->FindIKParams(handle);
+    return ikParams ? ikParams->Weight : 0;
+}
+
+float UBaseAnimInstance::GetIKRotationWeight(const FIKHandle& handle) const
+{
+    const FIKParams* ikParams = this->FindIKParams(handle);
+    return ikParams ? ikParams->RotationWeight : 0;
+}
+
+bool UBaseAnimInstance::IsIKHitted(const FIKHandle& handle) const
+{
+    const FIKParams* ikParams = this->FindIKParams(handle);
+    return ikParams && ikParams->Hitted;
+}
+
+FVector UBaseAnimInstance::GetIKRootLocation(int32 rootIndex) const
+{
+    const TArray<FIKRoots>& roots = this->GetIKStateOwner()->IKRoots;
+
+    if (!roots.IsValidIndex(rootIndex) || !roots[rootIndex].RootShouldDealocate)
+    {
+        return FVector::Zero();
+    }
+
+    return roots[rootIndex].RootLocation;
+}
+
+void UBaseAnimInstance::SetIKReverseMaskStartTraceLocation(const FIKHandle& handle, FVector newLocation)
+{
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+
+    if (owner->FindIKParams(handle))
+    {
+        owner->IKParams.Get(FSetElementId::FromInteger(handle.Index)).Value.ReverseMaskStartTraceLocation = newLocation;
+    }
 }
 
 TArray<FIKParams> UBaseAnimInstance::GetIKParamsValues()
 {
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+    if (owner != this)
+    {
+        return owner->GetIKParamsValues();
+    }
+
     TArray<FName> keys;
     TArray<FIKParams> values;
     
@@ -250,6 +1317,13 @@ void UBaseAnimInstance::SetStopping(bool flag)
 
 void UBaseAnimInstance::SetInitialIKTransitions(TArray<FTransitIKParams> iksToTransit)
 {
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+    if (owner != this)
+    {
+        owner->SetInitialIKTransitions(iksToTransit);
+        return;
+    }
+
     for (FTransitIKParams currentIK : iksToTransit)
     {
         if (this->IKParams.Contains(currentIK.IKName)) 
@@ -269,9 +1343,18 @@ void UBaseAnimInstance::SetInitialIKTransitions(TArray<FTransitIKParams> iksToTr
     }
 }
 
-#pragma optimize("", off)
+#if G_LAB_IK_DEOPTIMIZE
+UE_DISABLE_OPTIMIZATION
+#endif
 void UBaseAnimInstance::InterpolateIKTransition()
 {
+    UBaseAnimInstance* owner = this->GetIKStateOwner();
+    if (owner != this)
+    {
+        owner->InterpolateIKTransition();
+        return;
+    }
+
     TArray<FName> iks;
 
     this->IKTransitionInitialLocation.GetKeys(iks);
@@ -304,34 +1387,38 @@ void UBaseAnimInstance::InterpolateIKTransition()
         }
 
         FHitResult traceResult;
-        bool hitted = this->GetWorld()->SweepSingleByChannel(
-            traceResult,
-            startTrace,
-            startTrace + (this->IKParams[ik].TraceDirection * this->IKParams[ik].TraceLength),
-            FQuat::Identity,
-            ECollisionChannel::ECC_Visibility,
-            FCollisionShape::MakeSphere(this->IKParams[ik].TraceRadius)
-        );
+        bool hitted = this->TraceIKGround(this->IKParams[ik], startTrace, traceResult);
 
         
         if (hitted) 
         {
             transitingLocation = traceResult.ImpactPoint + ((this->IKParams[ik].TraceDirection * -1) * this->IKParams[ik].Padding);
-            this->IKParams[ik].FinalIKLocation = this->GetRelativeIKLocation(transitingLocation);
-        }
-        else
-        {
-            this->IKParams[ik].FinalIKLocation = this->GetRelativeIKLocation(transitingLocation);
         }
-        
+
+        FVector3f componentLocation = IKMath::ToComponentSpace(this->IKComponentTransform, transitingLocation);
+
+        this->IKParams[ik].FinalIKLocation = FVector(componentLocation);
+        this->IKParams[ik].ComponentLockLocation = componentLocation;
         this->IKParams[ik].CurrentLockLocation = transitingLocation;
     }
 }
-#pragma optimize("", on)
+#if G_LAB_IK_DEOPTIMIZE
+UE_ENABLE_OPTIMIZATION
+#endif
 
 void UBaseAnimInstance::CleanIKTransitions()
 {
-    this->IKTransitionInitialLocation.Empty();
+    this->GetIKStateOwner()->IKTransitionInitialLocation.Empty();
+}
+
+void UBaseAnimInstance::SetIKTransitioning(bool transitioning)
+{
+    this->GetIKStateOwner()->IsTransitioning = transitioning;
+}
+
+bool UBaseAnimInstance::IsIKTransitioning() const
+{
+    return this->GetIKStateOwner()->IsTransitioning;
 }
 
 FVector UBaseAnimInstance::GetRelativeIKLocation(FVector ikLocation)
@@ -343,8 +1430,9 @@ FVector UBaseAnimInstance::GetRelativeIKLocation(FVector ikLocation)
         return FVector();
     }
     
-    return FTransform(
+    return IKMath::ResolveMeshSpaceLocation(
         character->GetMesh()->GetComponentQuat(),
-        character->GetMesh()->GetComponentLocation()
-    ).InverseTransformPosition(ikLocation);
+        character->GetMesh()->GetComponentLocation(),
+        ikLocation
+    );
 }
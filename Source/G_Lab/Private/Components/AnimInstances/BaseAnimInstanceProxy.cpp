@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/AnimInstances/BaseAnimInstanceProxy.h"
+
+void FBaseAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+    FAnimInstanceProxy::PreUpdate(InAnimInstance, DeltaSeconds);
+
+    UBaseAnimInstance* animInstance = Cast<UBaseAnimInstance>(InAnimInstance);
+    AActor* owner = animInstance ? animInstance->GetOwningActor() : nullptr;
+
+    this->ComputeVelocityStats = animInstance
+                            && owner
+                            && animInstance->ComputeVelocityStatsInProxy
+                            && !animInstance->IsLayerSuspended
+                            && !animInstance->IsSleeping;
+
+    if (!this->ComputeVelocityStats)
+    {
+        return;
+    }
+
+    // Seeded from the instance every frame, SetStopping may have changed it on the game thread
+    this->VelocityStats = animInstance->GetInstanceVelocityStats();
+    this->OwnerVelocity = owner->GetVelocity();
+    this->IdleMoveThreshold = animInstance->IdleMoveThreshold;
+}
+
+void FBaseAnimInstanceProxy::Update(float DeltaSeconds)
+{
+    FAnimInstanceProxy::Update(DeltaSeconds);
+
+    if (this->ComputeVelocityStats)
+    {
+        this->VelocityStats.Update(this->OwnerVelocity, this->IdleMoveThreshold);
+    }
+}
+
+void FBaseAnimInstanceProxy::PostUpdate(UAnimInstance* InAnimInstance) const
+{
+    FAnimInstanceProxy::PostUpdate(InAnimInstance);
+
+    UBaseAnimInstance* animInstance = Cast<UBaseAnimInstance>(InAnimInstance);
+
+    if (this->ComputeVelocityStats && animInstance)
+    {
+        animInstance->SetInstanceVelocityStats(this->VelocityStats);
+    }
+}
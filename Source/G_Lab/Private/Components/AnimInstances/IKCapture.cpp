@@ -0,0 +1,461 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/AnimInstances/IKCapture.h"
+
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Components/AnimInstances/BaseAnimInstance.h"
+#include "Components/AnimInstances/IKMath.h"
+
+static_assert(TIsTriviallyCopyable<FIKCaptureFrameHeader>::Value, "Capture records must stay plain data");
+static_assert(TIsTriviallyCopyable<FIKCaptureIKRecord>::Value, "Capture records must stay plain data");
+static_assert(TIsTriviallyCopyable<FIKCaptureRootRecord>::Value, "Capture records must stay plain data");
+
+namespace
+{
+    constexpr int32 FlushThreshold = 64 * 1024;
+
+    template<typename RecordType>
+    void AppendRecord(TArray<uint8>& buffer, const RecordType& record)
+    {
+        buffer.Append(reinterpret_cast<const uint8*>(&record), sizeof(RecordType));
+    }
+
+    template<typename RecordType>
+    RecordType ReadRecord(const uint8* data)
+    {
+        RecordType record;
+        FMemory::Memcpy(&record, data, sizeof(RecordType));
+        return record;
+    }
+
+    bool HasStartTraceBoneReference(const FIKParams& ikParams)
+    {
+        return ikParams.StartTraceBoneReference.IsValid() && ikParams.StartTraceBoneReference.GetStringLength() > 0;
+    }
+
+    double GetRotationError(const FRotator& replayed, const FRotator& recorded)
+    {
+        FRotator difference = (replayed - recorded).GetNormalized();
+        return FMath::Max3(FMath::Abs(difference.Pitch), FMath::Abs(difference.Yaw), FMath::Abs(difference.Roll));
+    }
+}
+
+/*******
+* WRITER
+********/
+FIKCaptureWriter::~FIKCaptureWriter()
+{
+    this->Close();
+}
+
+bool FIKCaptureWriter::Open(const FString& filePath, const UBaseAnimInstance& animInstance)
+{
+    this->Close();
+
+    this->File.Reset(IFileManager::Get().CreateFileWriter(*filePath, FILEWRITE_AllowRead));
+
+    if (!this->File)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("IK capture: could not open %s"), *filePath);
+        return false;
+    }
+
+    this->FilePath = filePath;
+    this->FrameNumber = 0;
+    animInstance.IKParams.GetKeys(this->IKNames);
+
+    this->FrameSize = sizeof(FIKCaptureFrameHeader)
+                    + this->IKNames.Num() * sizeof(FIKCaptureIKRecord)
+                    + animInstance.IKRoots.Num() * sizeof(FIKCaptureRootRecord);
+
+    FIKCaptureFileHeader header;
+    FMemory::Memzero(header);
+    header.Magic = IKCapture::Magic;
+    header.Version = IKCapture::Version;
+    header.NumIKs = this->IKNames.Num();
+    header.NumRoots = animInstance.IKRoots.Num();
+    header.FrameSize = this->FrameSize;
+    AppendRecord(this->Buffer, header);
+
+    for (FName ikName : this->IKNames)
+    {
+        const FIKParams& ikParams = animInstance.IKParams[ikName];
+
+        FIKCaptureIKConfig config;
+        FMemory::Memzero(config);
+        FCStringAnsi::Strncpy(config.Name, TCHAR_TO_ANSI(*ikName.ToString()), IKCapture::MaxNameLength);
+        config.TraceDirection = ikParams.TraceDirection;
+        config.StartTraceMask = ikParams.StartTraceMask;
+        config.EffectorAddtiveRotationOffset = ikParams.EffectorAddtiveRotationOffset;
+        config.Padding = ikParams.Padding;
+        config.MaxLength = ikParams.MaxLength;
+        config.AddRelativeLocationFromReverseMask = ikParams.AddRelativeLocationFromReverseMask;
+        config.AlignEffectorBoneToSurface = ikParams.AlignEffectorBoneToSurface;
+        config.HasStartTraceBoneReference = HasStartTraceBoneReference(ikParams);
+        AppendRecord(this->Buffer, config);
+    }
+
+    for (const FIKRoots& root : animInstance.IKRoots)
+    {
+        FIKCaptureRootConfig config;
+        FMemory::Memzero(config);
+
+        for (FName childIK : root.ChildIKs)
+        {
+            if (config.NumChildIKs < IKCapture::MaxRootChildIKs)
+            {
+                config.ChildIKs[config.NumChildIKs++] = this->IKNames.IndexOfByKey(childIK);
+            }
+        }
+
+        AppendRecord(this->Buffer, config);
+    }
+
+    this->Flush();
+
+    return true;
+}
+
+void FIKCaptureWriter::Close()
+{
+    if (!this->File)
+    {
+        return;
+    }
+
+    this->Flush();
+    this->File->Close();
+    this->File.Reset();
+}
+
+bool FIKCaptureWriter::IsOpen() const
+{
+    return this->File.IsValid();
+}
+
+const FString& FIKCaptureWriter::GetFilePath() const
+{
+    return this->FilePath;
+}
+
+void FIKCaptureWriter::BeginFrame(const UBaseAnimInstance& animInstance)
+{
+    this->PreviousLockLocations.Reset();
+    this->PreviousComponentLockLocations.Reset();
+
+    for (FName ikName : this->IKNames)
+    {
+        const FIKParams* ikParams = animInstance.IKParams.Find(ikName);
+        this->PreviousLockLocations.Add(ikParams ? ikParams->CurrentLockLocation : FVector::Zero());
+        this->PreviousComponentLockLocations.Add(ikParams ? ikParams->ComponentLockLocation : FVector3f::ZeroVector);
+    }
+}
+
+void FIKCaptureWriter::EndFrame(const UBaseAnimInstance& animInstance, float deltaSeconds)
+{
+    USkeletalMeshComponent* body = animInstance.GetOwningComponent();
+    AActor* owner = animInstance.GetOwningActor();
+
+    if (!this->File || !body || this->PreviousLockLocations.Num() != this->IKNames.Num())
+    {
+        return;
+    }
+
+    FIKCaptureFrameHeader frame;
+    FMemory::Memzero(frame);
+    frame.FrameNumber = this->FrameNumber++;
+    frame.TimeSeconds = animInstance.GetWorld() ? animInstance.GetWorld()->GetTimeSeconds() : 0;
+    frame.Velocity = owner ? owner->GetVelocity() : FVector::Zero();
+    frame.MeshRotation = body->GetComponentQuat();
+    frame.MeshLocation = body->GetComponentLocation();
+    frame.DeltaSeconds = deltaSeconds;
+    frame.IsTransitioning = animInstance.IsTransitioning;
+    frame.ExecutionContext = (uint8)animInstance.IKExecutionContext;
+    frame.QualityTier = (uint8)animInstance.IKQualityTier;
+    AppendRecord(this->Buffer, frame);
+
+    for (int32 index = 0; index < this->IKNames.Num(); index++)
+    {
+        FIKCaptureIKRecord record;
+        FMemory::Memzero(record);
+
+        const FIKParams* ikParams = animInstance.IKParams.Find(this->IKNames[index]);
+        if (ikParams)
+        {
+            if (HasStartTraceBoneReference(*ikParams))
+            {
+                record.SocketLocation = body->GetSocketLocation(ikParams->StartTraceBoneReference);
+            }
+
+            record.ReverseMaskStartTraceLocation = ikParams->ReverseMaskStartTraceLocation;
+            record.PreviousLockLocation = this->PreviousLockLocations[index];
+            record.PreviousComponentLockLocation = this->PreviousComponentLockLocations[index];
+            record.ImpactPoint = ikParams->ImpactPoint;
+            record.HitNormal = ikParams->HitNormal;
+            record.Weight = ikParams->Weight;
+            record.LockWeight = ikParams->CurrentLockWeight;
+            record.RotationWeight = ikParams->RotationWeight;
+            record.Hitted = ikParams->Hitted;
+            record.Transitioning = animInstance.IsTransitioning
+                                && animInstance.IKTransitionInitialLocation.Contains(this->IKNames[index]);
+
+            record.StartReferenceLocation = ikParams->StartReferenceLocation;
+            record.CurrentLockLocation = ikParams->CurrentLockLocation;
+            record.FinalIKLocation = ikParams->FinalIKLocation;
+            record.EffectorAddtiveRotation = ikParams->EffectorAddtiveRotation;
+            record.ComponentLockLocation = ikParams->ComponentLockLocation;
+        }
+
+        AppendRecord(this->Buffer, record);
+    }
+
+    for (const FIKRoots& root : animInstance.IKRoots)
+    {
+        FIKCaptureRootRecord record;
+        FMemory::Memzero(record);
+        record.RootReferenceLocation = body->GetSocketLocation(root.RootReference);
+        record.RootLocation = root.RootLocation;
+        record.RootIKWeight = animInstance.GetCurveValue(root.RootIKWeightCurveName);
+        record.RootShouldDealocate = root.RootShouldDealocate;
+        AppendRecord(this->Buffer, record);
+    }
+
+    // Solves on anim workers keep buffering, the file is only written from the game thread
+    if (IsInGameThread())
+    {
+        this->FlushBuffered();
+    }
+}
+
+void FIKCaptureWriter::FlushBuffered()
+{
+    if (this->Buffer.Num() >= FlushThreshold)
+    {
+        this->Flush();
+    }
+}
+
+void FIKCaptureWriter::Flush()
+{
+    if (!this->File || this->Buffer.Num() == 0)
+    {
+        return;
+    }
+
+    this->File->Serialize(this->Buffer.GetData(), this->Buffer.Num());
+    this->File->Flush();
+    this->Buffer.Reset();
+}
+
+/*********
+* REPLAYER
+**********/
+bool FIKCaptureReplayer::Replay(const FString& filePath, double tolerance, FIKCaptureReplayReport& report)
+{
+    report = FIKCaptureReplayReport();
+
+    TUniquePtr<IMappedFileHandle> handle(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*filePath));
+    if (!handle || handle->GetFileSize() < (int64)sizeof(FIKCaptureFileHeader))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("IK capture: could not map %s"), *filePath);
+        return false;
+    }
+
+    TUniquePtr<IMappedFileRegion> region(handle->MapRegion(0, handle->GetFileSize()));
+    if (!region)
+    {
+        return false;
+    }
+
+    const uint8* data = region->GetMappedPtr();
+    int64 size = region->GetMappedSize();
+
+    FIKCaptureFileHeader header = ReadRecord<FIKCaptureFileHeader>(data);
+    if (header.Magic != IKCapture::Magic || header.Version != IKCapture::Version)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("IK capture: %s is not a version %d capture"), *filePath, IKCapture::Version);
+        return false;
+    }
+
+    // Counts come straight from the file, they are checked against the mapped size before any record is read
+    uint64 expectedFrameSize = sizeof(FIKCaptureFrameHeader)
+        + (uint64)header.NumIKs * sizeof(FIKCaptureIKRecord)
+        + (uint64)header.NumRoots * sizeof(FIKCaptureRootRecord);
+
+    int64 configOffset = sizeof(FIKCaptureFileHeader);
+    int64 rootConfigOffset = configOffset + (int64)header.NumIKs * sizeof(FIKCaptureIKConfig);
+    int64 framesOffset = rootConfigOffset + (int64)header.NumRoots * sizeof(FIKCaptureRootConfig);
+
+    if (header.FrameSize != expectedFrameSize || size < framesOffset)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("IK capture: %s is truncated or corrupt"), *filePath);
+        return false;
+    }
+
+    /******************
+    * REBUILD IK INPUTS
+    *******************/
+    TArray<FIKParams> ikParams;
+    TArray<bool> hasSocket;
+    for (uint32 index = 0; index < header.NumIKs; index++)
+    {
+        FIKCaptureIKConfig config = ReadRecord<FIKCaptureIKConfig>(data + configOffset + index * sizeof(FIKCaptureIKConfig));
+
+        FIKParams& currentParams = ikParams.AddDefaulted_GetRef();
+        currentParams.TraceDirection = config.TraceDirection;
+        currentParams.StartTraceMask = config.StartTraceMask;
+        currentParams.EffectorAddtiveRotationOffset = config.EffectorAddtiveRotationOffset;
+        currentParams.Padding = config.Padding;
+        currentParams.MaxLength = config.MaxLength;
+        currentParams.AddRelativeLocationFromReverseMask = config.AddRelativeLocationFromReverseMask != 0;
+        currentParams.AlignEffectorBoneToSurface = config.AlignEffectorBoneToSurface != 0;
+        hasSocket.Add(config.HasStartTraceBoneReference != 0);
+    }
+
+    TArray<FIKCaptureRootConfig> rootConfigs;
+    for (uint32 index = 0; index < header.NumRoots; index++)
+    {
+        FIKCaptureRootConfig& rootConfig = rootConfigs.Add_GetRef(ReadRecord<FIKCaptureRootConfig>(data + rootConfigOffset + index * sizeof(FIKCaptureRootConfig)));
+
+        if (rootConfig.NumChildIKs < 0 || rootConfig.NumChildIKs > IKCapture::MaxRootChildIKs)
+        {
+            UE_LOG(LogTemp, Warning, TEXT("IK capture: %s is truncated or corrupt"), *filePath);
+            return false;
+        }
+    }
+
+    report.NumFrames = (size - framesOffset) / header.FrameSize;
+
+    TArray<FIKCaptureIKRecord> records;
+    records.SetNum(header.NumIKs);
+
+    for (int32 frameIndex = 0; frameIndex < report.NumFrames; frameIndex++)
+    {
+        const uint8* frameData = data + framesOffset + (int64)frameIndex * header.FrameSize;
+        FIKCaptureFrameHeader frame = ReadRecord<FIKCaptureFrameHeader>(frameData);
+
+        if (frame.ExecutionContext != (uint8)EIKExecutionContext::Full)
+        {
+            continue;
+        }
+
+        report.NumComparedFrames++;
+        bool frameMismatch = false;
+        bool feetOnly = frame.QualityTier == (uint8)EIKQualityTier::FeetOnly;
+
+        FTransform componentTransform(frame.MeshRotation, frame.MeshLocation);
+
+        auto compare = [&](double error, double& maxError)
+        {
+            maxError = FMath::Max(maxError, error);
+            frameMismatch |= error > tolerance;
+        };
+
+        const uint8* ikData = frameData + sizeof(FIKCaptureFrameHeader);
+        for (uint32 index = 0; index < header.NumIKs; index++)
+        {
+            records[index] = ReadRecord<FIKCaptureIKRecord>(ikData + index * sizeof(FIKCaptureIKRecord));
+            const FIKCaptureIKRecord& record = records[index];
+            FIKParams& currentParams = ikParams[index];
+
+            currentParams.ReverseMaskStartTraceLocation = record.ReverseMaskStartTraceLocation;
+            currentParams.CurrentLockLocation = record.CurrentLockLocation;
+            currentParams.ComponentLockLocation = record.ComponentLockLocation;
+
+            if (hasSocket[index])
+            {
+                FVector startReference;
+                IKMath::ResolveStartTrace(currentParams, record.SocketLocation, startReference);
+                compare((startReference - FVector(record.StartReferenceLocation)).Length(), report.MaxLocationError);
+            }
+
+            if (!record.Hitted || record.Transitioning)
+            {
+                continue;
+            }
+
+            FVector3f componentLocation = IKMath::ResolveComponentIKLocation(
+                    IKMath::ToComponentSpace(componentTransform, record.ImpactPoint)
+                ,   record.PreviousComponentLockLocation
+                ,   IKMath::ToComponentDirection(componentTransform, currentParams.TraceDirection)
+                ,   currentParams.Padding
+                ,   record.LockWeight
+            );
+            FVector lockLocation = componentTransform.TransformPosition(FVector(componentLocation));
+
+            compare((lockLocation - FVector(record.CurrentLockLocation)).Length(), report.MaxLocationError);
+            compare((FVector(componentLocation) - FVector(record.FinalIKLocation)).Length(), report.MaxLocationError);
+
+            if (currentParams.AlignEffectorBoneToSurface && !feetOnly)
+            {
+                FRotator rotation = IKMath::ResolveSurfaceAlignment(currentParams, record.HitNormal);
+                compare(GetRotationError(rotation, record.EffectorAddtiveRotation), report.MaxRotationError);
+            }
+
+            currentParams.CurrentLockLocation = lockLocation;
+            currentParams.ComponentLockLocation = componentLocation;
+        }
+
+        const uint8* rootData = ikData + header.NumIKs * sizeof(FIKCaptureIKRecord);
+        for (uint32 index = 0; index < header.NumRoots; index++)
+        {
+            FIKCaptureRootRecord rootRecord = ReadRecord<FIKCaptureRootRecord>(rootData + index * sizeof(FIKCaptureRootRecord));
+            const FIKCaptureRootConfig& rootConfig = rootConfigs[index];
+
+            TArray<const FIKParams*, TInlineAllocator<IKCapture::MaxRootChildIKs>> childIKs;
+            bool childTransitioning = false;
+            for (int32 child = 0; child < rootConfig.NumChildIKs; child++)
+            {
+                int32 childIndex = rootConfig.ChildIKs[child];
+                if (ikParams.IsValidIndex(childIndex))
+                {
+                    childIKs.Add(&ikParams[childIndex]);
+                    childTransitioning |= records[childIndex].Transitioning != 0;
+                }
+            }
+
+            // Transitions move the locks after the roots pass, the recorded locks are not its inputs,
+            // and feet only frames do not run it
+            if (childTransitioning || feetOnly)
+            {
+                continue;
+            }
+
+            FVector directionDealocation;
+            float excedingDealocation;
+            bool rootShouldDealocate = IKMath::ResolveRootDislocation(
+                    IKMath::ToComponentSpace(componentTransform, rootRecord.RootReferenceLocation)
+                ,   childIKs
+                ,   directionDealocation
+                ,   excedingDealocation
+            );
+
+            if (rootShouldDealocate != (rootRecord.RootShouldDealocate != 0))
+            {
+                frameMismatch = true;
+                continue;
+            }
+
+            if (rootShouldDealocate)
+            {
+                FVector rootLocation = directionDealocation * excedingDealocation * rootRecord.RootIKWeight;
+                compare((rootLocation - FVector(rootRecord.RootLocation)).Length(), report.MaxLocationError);
+            }
+        }
+
+        if (frameMismatch)
+        {
+            report.NumMismatches++;
+
+            if (report.FirstMismatchFrame == INDEX_NONE)
+            {
+                report.FirstMismatchFrame = frame.FrameNumber;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/AnimInstances/IKGroundQuery.h"
+
+#include "Engine/HitResult.h"
+#include "Engine/World.h"
+#include "Subsystems/IKGroundQueryCache.h"
+
+void FIKGroundQueryParams::Build(ECollisionChannel channel, const TArray<AActor*>& ignoredActors)
+{
+    this->Channel = channel;
+
+    this->Line = FCollisionQueryParams(SCENE_QUERY_STAT(IKGroundLine), false);
+    this->Sweep = FCollisionQueryParams(SCENE_QUERY_STAT(IKGroundSweep), false);
+    this->Footprint = FCollisionQueryParams(SCENE_QUERY_STAT(IKGroundFootprint), false);
+
+    this->Line.AddIgnoredActors(ignoredActors);
+    this->Sweep.AddIgnoredActors(ignoredActors);
+    this->Footprint.AddIgnoredActors(ignoredActors);
+}
+
+bool FIKGroundQuery::Trace(
+        UWorld* world
+    ,   const FIKParams& ikParams
+    ,   const FVector& startTrace
+    ,   const FVector& lastImpactPoint
+    ,   EIKGroundQueryMode queryMode
+    ,   const FIKGroundQueryParams& queryParams
+    ,   FHitResult& traceResult
+)
+{
+    UIKGroundQueryCache* cache = queryParams.Cache.Get();
+
+    if (!cache)
+    {
+        return QueryPhysics(world, ikParams, startTrace, lastImpactPoint, queryMode, queryParams, traceResult);
+    }
+
+    FIKGroundQueryCacheKey cacheKey = cache->MakeKey(
+            startTrace
+        ,   ikParams.TraceDirection
+        ,   ikParams.TraceRadius
+        ,   ikParams.TraceLength
+        ,   queryParams.Channel
+        ,   (uint8)queryMode
+    );
+
+    if (cache->Find(cacheKey, startTrace, ikParams.TraceDirection, queryParams.Line, traceResult))
+    {
+        return true;
+    }
+
+    bool hitted = QueryPhysics(world, ikParams, startTrace, lastImpactPoint, queryMode, queryParams, traceResult);
+
+    if (hitted)
+    {
+        cache->Store(cacheKey, ikParams.TraceDirection, traceResult);
+    }
+
+    return hitted;
+}
+
+bool FIKGroundQuery::QueryPhysics(
+        UWorld* world
+    ,   const FIKParams& ikParams
+    ,   const FVector& startTrace
+    ,   const FVector& lastImpactPoint
+    ,   EIKGroundQueryMode queryMode
+    ,   const FIKGroundQueryParams& queryParams
+    ,   FHitResult& traceResult
+)
+{
+    FVector endTrace = startTrace + (ikParams.TraceDirection * ikParams.TraceLength);
+
+    auto sweep = [&](FHitResult& sweepResult) 
+    {
+        return world->SweepSingleByChannel(
+            sweepResult,
+            startTrace,
+            endTrace,
+            FQuat::Identity,
+            queryParams.Channel,
+            FCollisionShape::MakeSphere(ikParams.TraceRadius),
+            queryParams.Sweep
+        );
+    };
+
+    if (queryMode == EIKGroundQueryMode::Sweep)
+    {
+        return sweep(traceResult);
+    }
+
+    bool hitted = world->LineTraceSingleByChannel(
+        traceResult,
+        startTrace,
+        endTrace,
+        queryParams.Channel,
+        queryParams.Line
+    );
+
+    if (queryMode == EIKGroundQueryMode::Line)
+    {
+        return hitted;
+    }
+
+    /****************************
+    * ESCALATE ON EDGES AND SLOPES
+    *****************************/
+    float steepCos = FMath::Cos(FMath::DegreesToRadians(ikParams.SteepSurfaceAngle));
+    bool steep = hitted && FVector::DotProduct(traceResult.ImpactNormal, ikParams.TraceDirection * -1) < steepCos;
+    bool edge = hitted && FMath::Abs(
+        FVector::DotProduct(traceResult.ImpactPoint - lastImpactPoint, ikParams.TraceDirection)
+    ) > ikParams.EdgeHeightTolerance;
+
+    if (hitted && !steep && !edge)
+    {
+        return true;
+    }
+
+    FHitResult lineResult = traceResult;
+    bool lineHitted = hitted;
+
+    hitted = sweep(traceResult);
+
+    if (!hitted || !lineHitted || ikParams.FootprintSamples <= 0)
+    {
+        return hitted;
+    }
+
+    float stepDifference = FMath::Abs(
+        FVector::DotProduct(traceResult.ImpactPoint - lineResult.ImpactPoint, ikParams.TraceDirection)
+    );
+
+    if (stepDifference > ikParams.StepHeight)
+    {
+        SampleFootprint(world, ikParams, startTrace, queryParams, traceResult);
+    }
+
+    return hitted;
+}
+
+bool FIKGroundQuery::SampleFootprint(
+        UWorld* world
+    ,   const FIKParams& ikParams
+    ,   const FVector& startTrace
+    ,   const FIKGroundQueryParams& queryParams
+    ,   FHitResult& traceResult
+)
+{
+    FVector tangent;
+    FVector bitangent;
+    ikParams.TraceDirection.FindBestAxisVectors(tangent, bitangent);
+
+    FVector normalSum = FVector::Zero();
+    int32 hits = 0;
+    float nearestDistance = TNumericLimits<float>::Max();
+    FHitResult nearestResult;
+
+    for (int32 sample = 0; sample < ikParams.FootprintSamples; sample++)
+    {
+        float angle = (UE_TWO_PI * sample) / ikParams.FootprintSamples;
+        FVector sampleStart = startTrace 
+            + (tangent * FMath::Cos(angle) + bitangent * FMath::Sin(angle)) * ikParams.TraceRadius;
+
+        FHitResult sampleResult;
+        bool sampleHitted = world->LineTraceSingleByChannel(
+            sampleResult,
+            sampleStart,
+            sampleStart + (ikParams.TraceDirection * ikParams.TraceLength),
+            queryParams.Channel,
+            queryParams.Footprint
+        );
+
+        if (!sampleHitted)
+        {
+            continue;
+        }
+
+        hits++;
+        normalSum += sampleResult.ImpactNormal;
+
+        if (sampleResult.Distance < nearestDistance)
+        {
+            nearestDistance = sampleResult.Distance;
+            nearestResult = sampleResult;
+        }
+    }
+
+    if (hits == 0)
+    {
+        return false;
+    }
+
+    FVector footprintNormal = normalSum.GetSafeNormal();
+    nearestResult.ImpactPoint = startTrace + (ikParams.TraceDirection * nearestDistance);
+    nearestResult.Normal = footprintNormal;
+    nearestResult.ImpactNormal = footprintNormal;
+    traceResult = nearestResult;
+
+    return true;
+}
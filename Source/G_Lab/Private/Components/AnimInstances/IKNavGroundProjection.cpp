@@ -0,0 +1,199 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/AnimInstances/IKNavGroundProjection.h"
+
+#include "Engine/HitResult.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+
+namespace
+{
+    FVector GetProjectionPoint(const FIKNavGroundQuery& query)
+    {
+        return query.StartTrace + (query.TraceDirection * (query.TraceLength * 0.5f));
+    }
+
+    FVector GetProjectionExtent(const FIKNavGroundQuery& query)
+    {
+        return (query.TraceDirection.GetAbs() * (query.TraceLength * 0.5f)) + FVector(FMath::Max(query.TraceRadius, 1.f));
+    }
+}
+
+bool FIKNavGroundProjection::Project(
+        UWorld* world
+    ,   const FVector& startTrace
+    ,   const FVector& traceDirection
+    ,   float traceLength
+    ,   float traceRadius
+    ,   float maxSurfaceAngle
+    ,   FHitResult& traceResult
+)
+{
+    const ARecastNavMesh* navMesh = GetNavMesh(world);
+
+    if (!navMesh)
+    {
+        return false;
+    }
+
+    FIKNavGroundQuery query;
+    query.StartTrace = startTrace;
+    query.TraceDirection = traceDirection;
+    query.TraceLength = traceLength;
+    query.TraceRadius = traceRadius;
+
+    FNavLocation navLocation;
+    if (!navMesh->ProjectPoint(GetProjectionPoint(query), navLocation, GetProjectionExtent(query)))
+    {
+        return false;
+    }
+
+    FVector location;
+    FVector normal;
+    if (!RefineProjection(navMesh, query, navLocation.NodeRef, navLocation.Location, maxSurfaceAngle, location, normal))
+    {
+        return false;
+    }
+
+    query.Hitted = true;
+    query.Location = location;
+    query.Normal = normal;
+    BuildHitResult(query, traceResult);
+
+    return true;
+}
+
+void FIKNavGroundProjection::BuildHitResult(const FIKNavGroundQuery& query, FHitResult& traceResult)
+{
+    traceResult = FHitResult(query.StartTrace, query.StartTrace + (query.TraceDirection * query.TraceLength));
+    traceResult.bBlockingHit = query.Hitted;
+    traceResult.Location = query.Location;
+    traceResult.ImpactPoint = query.Location;
+    traceResult.Normal = query.Normal;
+    traceResult.ImpactNormal = query.Normal;
+    traceResult.Distance = FVector::DotProduct(query.Location - query.StartTrace, query.TraceDirection);
+    traceResult.Time = query.TraceLength > 0 ? traceResult.Distance / query.TraceLength : 0;
+}
+
+void FIKNavGroundProjection::ProjectBatch(UWorld* world, TArray<FIKNavGroundQuery>& queries, float maxSurfaceAngle)
+{
+    for (FIKNavGroundQuery& query : queries)
+    {
+        query.Hitted = false;
+    }
+
+    const ARecastNavMesh* navMesh = GetNavMesh(world);
+
+    if (!navMesh || queries.Num() == 0)
+    {
+        return;
+    }
+
+    /*******************************
+    * ONE NAV QUERY FOR ALL THE FEET
+    ********************************/
+    TArray<FNavigationProjectionWork> workload;
+    workload.Reserve(queries.Num());
+
+    FVector batchExtent = FVector::Zero();
+    for (const FIKNavGroundQuery& query : queries)
+    {
+        workload.Emplace(GetProjectionPoint(query));
+        batchExtent = batchExtent.ComponentMax(GetProjectionExtent(query));
+    }
+
+    navMesh->BatchProjectPoints(workload, batchExtent);
+
+    for (int32 index = 0; index < queries.Num(); index++)
+    {
+        if (!workload[index].bResult)
+        {
+            continue;
+        }
+
+        queries[index].Hitted = RefineProjection(
+                navMesh
+            ,   queries[index]
+            ,   workload[index].OutLocation.NodeRef
+            ,   workload[index].OutLocation.Location
+            ,   maxSurfaceAngle
+            ,   queries[index].Location
+            ,   queries[index].Normal
+        );
+    }
+}
+
+ARecastNavMesh* FIKNavGroundProjection::GetNavMesh(UWorld* world)
+{
+    UNavigationSystemV1* navigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(world);
+
+    if (!navigationSystem)
+    {
+        return nullptr;
+    }
+
+    return Cast<ARecastNavMesh>(navigationSystem->GetDefaultNavDataInstance(FNavigationSystem::DontCreate));
+}
+
+bool FIKNavGroundProjection::RefineProjection(
+        const ARecastNavMesh* navMesh
+    ,   const FIKNavGroundQuery& query
+    ,   NavNodeRef polyRef
+    ,   const FVector& projectedLocation
+    ,   float maxSurfaceAngle
+    ,   FVector& outLocation
+    ,   FVector& outNormal
+)
+{
+    TArray<FVector> polyVerts;
+    if (!navMesh->GetPolyVerts(polyRef, polyVerts) || polyVerts.Num() < 3)
+    {
+        return false;
+    }
+
+    FVector polyNormal = FVector::Zero();
+    for (int32 index = 0; index < polyVerts.Num(); index++)
+    {
+        const FVector& current = polyVerts[index];
+        const FVector& next = polyVerts[(index + 1) % polyVerts.Num()];
+
+        polyNormal.X += (current.Y - next.Y) * (current.Z + next.Z);
+        polyNormal.Y += (current.Z - next.Z) * (current.X + next.X);
+        polyNormal.Z += (current.X - next.X) * (current.Y + next.Y);
+    }
+
+    polyNormal = polyNormal.GetSafeNormal();
+    if (FVector::DotProduct(polyNormal, query.TraceDirection) > 0)
+    {
+        polyNormal *= -1;
+    }
+
+    float maxSurfaceCos = FMath::Cos(FMath::DegreesToRadians(maxSurfaceAngle));
+    if (FVector::DotProduct(polyNormal, query.TraceDirection * -1) < maxSurfaceCos)
+    {
+        return false;
+    }
+
+    // Borders are eroded by the agent radius, ProjectPoint would pull the foot sideways onto the poly
+    FVector::FReal planeDistance = FVector::DotProduct(projectedLocation - query.StartTrace, polyNormal) 
+        / FVector::DotProduct(query.TraceDirection, polyNormal);
+    FVector refinedLocation = query.StartTrace + (query.TraceDirection * planeDistance);
+
+    FVector::FReal polyHeight = 0;
+    if (navMesh->GetPolyHeight(polyRef, refinedLocation, polyHeight))
+    {
+        refinedLocation.Z = polyHeight;
+    }
+
+    float distance = FVector::DotProduct(refinedLocation - query.StartTrace, query.TraceDirection);
+    if (distance < 0 || distance > query.TraceLength)
+    {
+        return false;
+    }
+
+    outLocation = refinedLocation;
+    outNormal = polyNormal;
+
+    return true;
+}
@@ -6,11 +6,63 @@
 #include <EnhancedInputSubsystems.h>
 #include <EnhancedInputComponent.h>
 
+#include "G_Lab.h"
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Components/AnimInstances/BaseAnimInstance.h"
+#include "Components/AnimInstances/IKMath.h"
+#include "Subsystems/BaseCrowdTickSubsystem.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Input To Movement (ms)"), STAT_GLab_InputToMovement, STATGROUP_GLab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Input To Pose (ms)"), STAT_GLab_InputToPose, STATGROUP_GLab);
+
+CSV_DEFINE_CATEGORY(GLabInput, true);
+
+namespace
+{
+	/** Contact shown between two summaries, false when the target foot has no ground */
+	bool ResolveIKContact(
+		const FIKContactSummary& previous,
+		const FIKContactSummary& target,
+		float alpha,
+		int32 footIndex,
+		float& impactHeight,
+		FVector3f& impactNormal
+	)
+	{
+		if (!target.IsHitted(footIndex))
+		{
+			return false;
+		}
+
+		impactHeight = target.GetImpactHeight(footIndex);
+		impactNormal = target.GetImpactNormal(footIndex);
+
+		if (previous.IsHitted(footIndex) && alpha < 1)
+		{
+			impactHeight = FMath::Lerp(previous.GetImpactHeight(footIndex), impactHeight, alpha);
+			impactNormal = FMath::Lerp(previous.GetImpactNormal(footIndex), impactNormal, alpha).GetSafeNormal();
+		}
+
+		return true;
+	}
+}
+
+static TAutoConsoleVariable<bool> CVarForceReplicatedIKContacts(
+	TEXT("GLab.IKContacts.ForceReplicated"),
+	false,
+	TEXT("Simulated proxies use the replicated IK contacts at any distance, to test them in local multi-client PIE."),
+	ECVF_Default
+);
+
 // Sets default values
 ABase::ABase()
 {
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
+	// Only locally controlled players keep their own tick, everyone else is ticked by UBaseCrowdTickSubsystem.
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 }
 
@@ -18,7 +70,19 @@ ABase::ABase()
 void ABase::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	this->UpdateInputLatencyBindings();
+	this->UpdateTickMode();
+}
+
+void ABase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UBaseCrowdTickSubsystem* crowdTick = this->GetWorld()->GetSubsystem<UBaseCrowdTickSubsystem>())
+	{
+		crowdTick->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -26,6 +90,83 @@ void ABase::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	this->BatchedTick(DeltaTime);
+}
+
+void ABase::BatchedTick(float DeltaTime)
+{
+	this->TickIKContacts(DeltaTime);
+	this->TickSettledSleep();
+}
+
+void ABase::TickSettledSleep()
+{
+	// Runs from the actor, a frozen mesh no longer ticks its anim instance
+	UBaseAnimInstance* animInstance = Cast<UBaseAnimInstance>(this->GetMesh()->GetAnimInstance());
+
+	if (!animInstance)
+	{
+		return;
+	}
+
+	// Local players would lose a frame of response to input, only AI and simulated proxies sleep
+	if (this->IsLocallyControlled() && this->IsPlayerControlled())
+	{
+		if (animInstance->IsSleeping)
+		{
+			animInstance->WakeFromSleep();
+		}
+
+		return;
+	}
+
+	animInstance->UpdateSettledSleep();
+}
+
+void ABase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(ABase, IKContactSummary, COND_SimulatedOnly);
+}
+
+void ABase::NotifyControllerChanged()
+{
+	Super::NotifyControllerChanged();
+
+	if (this->HasActorBegunPlay())
+	{
+		this->UpdateInputLatencyBindings();
+		this->UpdateTickMode();
+	}
+}
+
+void ABase::UpdateTickMode()
+{
+	UBaseCrowdTickSubsystem* crowdTick = this->GetWorld()->GetSubsystem<UBaseCrowdTickSubsystem>();
+
+	// Blueprints implementing Event Tick keep the actor tick so the event still fires
+	bool implementsTickEvent = this->GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AActor, ReceiveTick));
+	bool batched = this->UseBatchedTick 
+				&& crowdTick 
+				&& !implementsTickEvent
+				&& !(this->IsPlayerControlled() && this->IsLocallyControlled());
+
+	this->SetActorTickEnabled(!batched);
+
+	if (!crowdTick)
+	{
+		return;
+	}
+
+	if (batched)
+	{
+		crowdTick->Register(this);
+	}
+	else
+	{
+		crowdTick->Unregister(this);
+	}
 }
 
 // Called to bind functionality to input
@@ -61,10 +202,233 @@ void ABase::Look(const FInputActionValue& value)
 
 void ABase::Move(const FInputActionValue& value)
 {
+	this->MarkInputReceived();
+
 	FVector inputDirection = value.Get<FVector>();
-	FVector movementDirection = FRotator( 0, this->GetControlRotation().Yaw - 90, 0 ).RotateVector(inputDirection);
 
-	this->AddMovementInput(FVector(movementDirection.X, movementDirection.Y, 0), inputDirection.Length());
+	// Yaw only rotation of the input, same as FRotator(0, yaw - 90, 0).RotateVector without building the rotator
+	double yawSin;
+	double yawCos;
+	FMath::SinCos(&yawSin, &yawCos, FMath::DegreesToRadians(this->GetControlRotation().Yaw - 90));
+
+	FVector movementDirection = FVector(
+			inputDirection.X * yawCos - inputDirection.Y * yawSin
+		,	inputDirection.X * yawSin + inputDirection.Y * yawCos
+		,	0
+	);
+
+	this->AddMovementInput(movementDirection, inputDirection.Length());
+
+}
+
+void ABase::TickIKContacts(float deltaSeconds)
+{
+	if (!this->ReplicateIKContacts)
+	{
+		return;
+	}
+
+	if (this->HasAuthority())
+	{
+		this->TimeSinceIKContactSend += deltaSeconds;
+
+		if (this->TimeSinceIKContactSend >= 1 / FMath::Max(this->IKContactSendRate, 0.1f))
+		{
+			this->TimeSinceIKContactSend = 0;
+			this->UpdateIKContactSummary();
+		}
+
+		return;
+	}
+
+	if (this->GetLocalRole() != ROLE_SimulatedProxy || this->IKContactSummary.NumFeet == 0)
+	{
+		this->UseReplicatedIKContacts = false;
+		return;
+	}
+
+	this->IKContactInterpolationAlpha = FMath::Min(
+		this->IKContactInterpolationAlpha + deltaSeconds / FMath::Max(this->IKContactInterpolationTime, UE_KINDA_SMALL_NUMBER),
+		1.f
+	);
+
+	if (CVarForceReplicatedIKContacts.GetValueOnGameThread())
+	{
+		this->UseReplicatedIKContacts = true;
+		return;
+	}
+
+	float nearestDistanceSquared = TNumericLimits<float>::Max();
+	for (FConstPlayerControllerIterator iterator = this->GetWorld()->GetPlayerControllerIterator(); iterator; ++iterator)
+	{
+		APlayerController* playerController = iterator->Get();
+
+		if (playerController && playerController->IsLocalController())
+		{
+			FVector viewLocation;
+			FRotator viewRotation;
+			playerController->GetPlayerViewPoint(viewLocation, viewRotation);
+			nearestDistanceSquared = FMath::Min(nearestDistanceSquared, FVector::DistSquared(viewLocation, this->GetActorLocation()));
+		}
+	}
+
+	this->UseReplicatedIKContacts = nearestDistanceSquared >= FMath::Square(this->ReplicatedIKContactMinDistance);
+}
+
+void ABase::UpdateIKContactSummary()
+{
+	USkeletalMeshComponent* body = this->GetMesh();
+	UBaseAnimInstance* animInstance = body ? Cast<UBaseAnimInstance>(body->GetAnimInstance()) : nullptr;
+
+	if (!animInstance)
+	{
+		return;
+	}
+
+	FTransform componentTransform(body->GetComponentQuat(), body->GetComponentLocation());
+
+	// Feet are sent in replication order, by name, so it does not depend on how each machine built IKParams
+	const TArray<FName>& ikNames = animInstance->GetIKNamesInReplicationOrder();
+
+	FIKContactSummary summary;
+	for (int32 footIndex = 0; footIndex < ikNames.Num(); footIndex++)
+	{
+		const FIKParams& ikParams = animInstance->IKParams[ikNames[footIndex]];
+
+		summary.SetFoot(
+				footIndex
+			,	ikParams.Hitted
+			,	ikParams.Planted
+			,	IKMath::ToComponentSpace(componentTransform, ikParams.ImpactPoint).Z
+			,	IKMath::ToComponentDirection(componentTransform, ikParams.HitNormal)
+		);
+	}
+
+	for (int32 rootIndex = 0; rootIndex < animInstance->IKRoots.Num(); rootIndex++)
+	{
+		const FIKRoots& root = animInstance->IKRoots[rootIndex];
+		summary.SetRootOffset(rootIndex, root.RootShouldDealocate ? root.RootLocation.Z : 0);
+	}
+
+	if (!(summary == this->IKContactSummary))
+	{
+		this->IKContactSummary = summary;
+	}
+}
+
+void ABase::OnRep_IKContactSummary(const FIKContactSummary& oldSummary)
+{
+	// Restart from the contact shown towards the old summary, IKContactSummary already holds the new one
+	FIKContactSummary shownSummary;
+	for (int32 foot = 0; foot < oldSummary.NumFeet; foot++)
+	{
+		float impactHeight = 0;
+		FVector3f impactNormal = FVector3f::UpVector;
+		bool hitted = ResolveIKContact(
+			this->PreviousIKContactSummary, 
+			oldSummary, 
+			this->IKContactInterpolationAlpha, 
+			foot, 
+			impactHeight, 
+			impactNormal
+		);
+		shownSummary.SetFoot(foot, hitted, oldSummary.IsPlanted(foot), impactHeight, impactNormal);
+	}
+
+	for (int32 root = 0; root < oldSummary.NumRoots; root++)
+	{
+		shownSummary.SetRootOffset(root, FMath::Lerp(
+			this->PreviousIKContactSummary.GetRootOffset(root),
+			oldSummary.GetRootOffset(root),
+			this->IKContactInterpolationAlpha
+		));
+	}
+
+	this->PreviousIKContactSummary = shownSummary;
+	this->IKContactInterpolationAlpha = 0;
+}
+
+bool ABase::UsesReplicatedIKContacts() const
+{
+	return this->UseReplicatedIKContacts;
+}
+
+bool ABase::GetReplicatedIKContact(int32 footIndex, float& impactHeight, FVector3f& impactNormal) const
+{
+	return ResolveIKContact(
+		this->PreviousIKContactSummary,
+		this->IKContactSummary,
+		this->IKContactInterpolationAlpha,
+		footIndex,
+		impactHeight,
+		impactNormal
+	);
+}
 
+float ABase::GetReplicatedIKRootOffset(int32 rootIndex) const
+{
+	return FMath::Lerp(
+		this->PreviousIKContactSummary.GetRootOffset(rootIndex),
+		this->IKContactSummary.GetRootOffset(rootIndex),
+		this->IKContactInterpolationAlpha
+	);
+}
+
+void ABase::MarkInputReceived()
+{
+	if (UBaseAnimInstance* animInstance = Cast<UBaseAnimInstance>(this->GetMesh()->GetAnimInstance()))
+	{
+		animInstance->WakeFromSleep();
+	}
+
+	if (this->InstrumentInputLatency && this->PendingInputCycles == 0)
+	{
+		this->PendingInputCycles = FPlatformTime::Cycles64();
+	}
 }
 
+void ABase::UpdateInputLatencyBindings()
+{
+	// AI crowds never receive input, binding them would only add delegate calls per movement and pose update
+	if (this->InstrumentInputLatency && this->IsPlayerControlled() && this->IsLocallyControlled())
+	{
+		this->OnCharacterMovementUpdated.AddUniqueDynamic(this, &ABase::OnInputMovementApplied);
+		this->GetMesh()->OnBoneTransformsFinalized.AddUniqueDynamic(this, &ABase::OnInputPoseFinalized);
+		return;
+	}
+
+	this->OnCharacterMovementUpdated.RemoveDynamic(this, &ABase::OnInputMovementApplied);
+	this->GetMesh()->OnBoneTransformsFinalized.RemoveDynamic(this, &ABase::OnInputPoseFinalized);
+	this->PendingInputCycles = 0;
+	this->InputMovementCycles = 0;
+}
+
+void ABase::OnInputMovementApplied(float deltaSeconds, FVector oldLocation, FVector oldVelocity)
+{
+	if (this->PendingInputCycles == 0 || this->InputMovementCycles != 0)
+	{
+		return;
+	}
+
+	this->InputMovementCycles = FPlatformTime::Cycles64();
+	this->LastInputToMovementMs = FPlatformTime::ToMilliseconds64(this->InputMovementCycles - this->PendingInputCycles);
+
+	SET_FLOAT_STAT(STAT_GLab_InputToMovement, this->LastInputToMovementMs);
+	CSV_CUSTOM_STAT(GLabInput, InputToMovementMs, this->LastInputToMovementMs, ECsvCustomStatOp::Set);
+}
+
+void ABase::OnInputPoseFinalized()
+{
+	if (this->InputMovementCycles == 0)
+	{
+		return;
+	}
+
+	this->LastInputToPoseMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - this->PendingInputCycles);
+
+	SET_FLOAT_STAT(STAT_GLab_InputToPose, this->LastInputToPoseMs);
+	CSV_CUSTOM_STAT(GLabInput, InputToPoseMs, this->LastInputToPoseMs, ECsvCustomStatOp::Set);
+
+	this->PendingInputCycles = 0;
+	this->InputMovementCycles = 0;
+}
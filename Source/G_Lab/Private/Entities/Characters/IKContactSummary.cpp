@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Entities/Characters/IKContactSummary.h"
+
+namespace
+{
+    int16 QuantizeDistance(float distance)
+    {
+        return (int16)FMath::Clamp(FMath::RoundToInt32(distance * 10), (int32)MIN_int16, (int32)MAX_int16);
+    }
+
+    float DequantizeDistance(int16 quantized)
+    {
+        return quantized * 0.1f;
+    }
+
+    uint8 QuantizeUnit(float value)
+    {
+        return (uint8)FMath::RoundToInt32((FMath::Clamp(value, -1.f, 1.f) * 0.5f + 0.5f) * 255);
+    }
+
+    float DequantizeUnit(uint8 quantized)
+    {
+        return (quantized / 255.f) * 2 - 1;
+    }
+
+    void SerializeDistance(FArchive& Ar, int16& distance)
+    {
+        uint16 bits = (uint16)distance;
+        Ar.SerializeBits(&bits, 16);
+        distance = (int16)bits;
+    }
+}
+
+void FIKContactSummary::SetFoot(int32 footIndex, bool hitted, bool planted, float impactHeight, const FVector3f& impactNormal)
+{
+    if (footIndex < 0 || footIndex >= MaxFeet)
+    {
+        return;
+    }
+
+    this->NumFeet = FMath::Max<uint8>(this->NumFeet, footIndex + 1);
+    this->HittedMask = hitted ? this->HittedMask | (1 << footIndex) : this->HittedMask & ~(1 << footIndex);
+    this->PlantedMask = planted ? this->PlantedMask | (1 << footIndex) : this->PlantedMask & ~(1 << footIndex);
+
+    if (!hitted)
+    {
+        this->ImpactHeights[footIndex] = 0;
+        this->ImpactNormals[footIndex][0] = 0;
+        this->ImpactNormals[footIndex][1] = 0;
+        return;
+    }
+
+    // Octahedral projection, folded on the lower hemisphere
+    FVector3f normal = impactNormal.GetSafeNormal(UE_SMALL_NUMBER, FVector3f::UpVector);
+    float manhattan = FMath::Abs(normal.X) + FMath::Abs(normal.Y) + FMath::Abs(normal.Z);
+    FVector2f octahedral = FVector2f(normal.X, normal.Y) / manhattan;
+
+    if (normal.Z < 0)
+    {
+        octahedral = FVector2f(
+                (1 - FMath::Abs(octahedral.Y)) * FMath::Sign(octahedral.X)
+            ,   (1 - FMath::Abs(octahedral.X)) * FMath::Sign(octahedral.Y)
+        );
+    }
+
+    this->ImpactHeights[footIndex] = QuantizeDistance(impactHeight);
+    this->ImpactNormals[footIndex][0] = QuantizeUnit(octahedral.X);
+    this->ImpactNormals[footIndex][1] = QuantizeUnit(octahedral.Y);
+}
+
+void FIKContactSummary::SetRootOffset(int32 rootIndex, float rootOffset)
+{
+    if (rootIndex < 0 || rootIndex >= MaxRoots)
+    {
+        return;
+    }
+
+    this->NumRoots = FMath::Max<uint8>(this->NumRoots, rootIndex + 1);
+    this->RootOffsets[rootIndex] = QuantizeDistance(rootOffset);
+}
+
+bool FIKContactSummary::IsHitted(int32 footIndex) const
+{
+    return footIndex >= 0 && footIndex < this->NumFeet && (this->HittedMask & (1 << footIndex)) != 0;
+}
+
+bool FIKContactSummary::IsPlanted(int32 footIndex) const
+{
+    return footIndex >= 0 && footIndex < this->NumFeet && (this->PlantedMask & (1 << footIndex)) != 0;
+}
+
+float FIKContactSummary::GetImpactHeight(int32 footIndex) const
+{
+    return this->IsHitted(footIndex) ? DequantizeDistance(this->ImpactHeights[footIndex]) : 0;
+}
+
+FVector3f FIKContactSummary::GetImpactNormal(int32 footIndex) const
+{
+    if (!this->IsHitted(footIndex))
+    {
+        return FVector3f::UpVector;
+    }
+
+    FVector2f octahedral(DequantizeUnit(this->ImpactNormals[footIndex][0]), DequantizeUnit(this->ImpactNormals[footIndex][1]));
+    FVector3f normal(octahedral.X, octahedral.Y, 1 - FMath::Abs(octahedral.X) - FMath::Abs(octahedral.Y));
+
+    if (normal.Z < 0)
+    {
+        float foldedX = (1 - FMath::Abs(normal.Y)) * FMath::Sign(normal.X);
+        float foldedY = (1 - FMath::Abs(normal.X)) * FMath::Sign(normal.Y);
+        normal.X = foldedX;
+        normal.Y = foldedY;
+    }
+
+    return normal.GetSafeNormal(UE_SMALL_NUMBER, FVector3f::UpVector);
+}
+
+float FIKContactSummary::GetRootOffset(int32 rootIndex) const
+{
+    return rootIndex >= 0 && rootIndex < this->NumRoots ? DequantizeDistance(this->RootOffsets[rootIndex]) : 0;
+}
+
+bool FIKContactSummary::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    Ar.SerializeBits(&this->NumFeet, 3);
+    Ar.SerializeBits(&this->NumRoots, 2);
+    this->NumFeet = FMath::Min<uint8>(this->NumFeet, MaxFeet);
+    this->NumRoots = FMath::Min<uint8>(this->NumRoots, MaxRoots);
+
+    Ar.SerializeBits(&this->HittedMask, this->NumFeet);
+    Ar.SerializeBits(&this->PlantedMask, this->NumFeet);
+
+    // Feet without ground only cost their two flag bits
+    for (int32 foot = 0; foot < this->NumFeet; foot++)
+    {
+        if (!this->IsHitted(foot))
+        {
+            continue;
+        }
+
+        SerializeDistance(Ar, this->ImpactHeights[foot]);
+        Ar.SerializeBits(&this->ImpactNormals[foot][0], 8);
+        Ar.SerializeBits(&this->ImpactNormals[foot][1], 8);
+    }
+
+    for (int32 root = 0; root < this->NumRoots; root++)
+    {
+        SerializeDistance(Ar, this->RootOffsets[root]);
+    }
+
+    bOutSuccess = !Ar.IsError();
+    return true;
+}
+
+bool FIKContactSummary::operator==(const FIKContactSummary& other) const
+{
+    return this->NumFeet == other.NumFeet
+        && this->NumRoots == other.NumRoots
+        && this->HittedMask == other.HittedMask
+        && this->PlantedMask == other.PlantedMask
+        && FMemory::Memcmp(this->ImpactHeights, other.ImpactHeights, sizeof(this->ImpactHeights)) == 0
+        && FMemory::Memcmp(this->ImpactNormals, other.ImpactNormals, sizeof(this->ImpactNormals)) == 0
+        && FMemory::Memcmp(this->RootOffsets, other.RootOffsets, sizeof(this->RootOffsets)) == 0;
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/IKFootPlacementFragments.h"
+
+void FMassIKFootPlacementConfigFragment::CopyToAnimInstance(const FMassIKFootPlacementFragment& fragment, UBaseAnimInstance& animInstance) const
+{
+    int32 numFeet = FMath::Min(this->Feet.Num(), FMassIKFootPlacementFragment::MaxFeet);
+
+    for (int32 foot = 0; foot < numFeet; foot++)
+    {
+        FIKParams* ikParams = animInstance.IKParams.Find(this->Feet[foot].IKName);
+
+        if (!ikParams)
+        {
+            continue;
+        }
+
+        const FMassIKFootState& footState = fragment.Feet[foot];
+        ikParams->StartReferenceLocation = footState.StartReferenceLocation;
+        ikParams->CurrentLockLocation = footState.CurrentLockLocation;
+        ikParams->ImpactPoint = footState.ImpactPoint;
+        ikParams->HitNormal = footState.HitNormal;
+        ikParams->EffectorAddtiveRotation = footState.EffectorAddtiveRotation;
+        ikParams->Hitted = footState.Hitted;
+        ikParams->Planted = footState.Planted;
+    }
+
+    animInstance.InvalidateIKComponentSpace();
+}
+
+void FMassIKFootPlacementConfigFragment::CopyFromAnimInstance(const UBaseAnimInstance& animInstance, FMassIKFootPlacementFragment& fragment) const
+{
+    int32 numFeet = FMath::Min(this->Feet.Num(), FMassIKFootPlacementFragment::MaxFeet);
+
+    for (int32 foot = 0; foot < numFeet; foot++)
+    {
+        const FIKParams* ikParams = animInstance.IKParams.Find(this->Feet[foot].IKName);
+
+        if (!ikParams)
+        {
+            continue;
+        }
+
+        FMassIKFootState& footState = fragment.Feet[foot];
+        footState.StartReferenceLocation = ikParams->StartReferenceLocation;
+        footState.CurrentLockLocation = ikParams->CurrentLockLocation;
+        footState.ImpactPoint = ikParams->ImpactPoint;
+        footState.HitNormal = ikParams->HitNormal;
+        footState.EffectorAddtiveRotation = ikParams->EffectorAddtiveRotation;
+        footState.Weight = ikParams->Weight;
+        footState.Hitted = ikParams->Hitted;
+        footState.Planted = ikParams->Planted;
+    }
+}
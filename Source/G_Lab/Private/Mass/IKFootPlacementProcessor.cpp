@@ -0,0 +1,319 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/IKFootPlacementProcessor.h"
+
+#include "MassActorSubsystem.h"
+#include "MassCommonFragments.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "MassRepresentationFragments.h"
+#include "Components/AnimInstances/IKGroundQuery.h"
+#include "Components/AnimInstances/IKMath.h"
+#include "Components/AnimInstances/IKNavGroundProjection.h"
+#include "Entities/Characters/Base.h"
+#include "Mass/IKFootPlacementFragments.h"
+#include "Subsystems/IKGroundQueryCache.h"
+
+namespace
+{
+    bool ShouldSolve(const FMassIKFootPlacementFragment& placement, TConstArrayView<FMassRepresentationLODFragment> lods, int32 entity)
+    {
+        return !placement.RepresentedByActor && (lods.Num() == 0 || lods[entity].LOD != EMassLOD::Off);
+    }
+
+    FVector ResolveFootStartTrace(const FMassIKFootConfig& footConfig, const FTransform& transform, FMassIKFootState& footState)
+    {
+        FVector startReference;
+        FVector startTrace = IKMath::ResolveStartTrace(
+                footConfig.Params
+            ,   transform.TransformPosition(footConfig.LocalStartReference)
+            ,   startReference
+        );
+
+        footState.StartReferenceLocation = startReference;
+
+        return startTrace;
+    }
+
+    void ApplyFootHit(
+            const FIKParams& ikParams
+        ,   const FTransform& transform
+        ,   bool hitted
+        ,   const FHitResult& traceResult
+        ,   FMassIKFootState& footState
+    )
+    {
+        footState.Hitted = hitted;
+        footState.Planted = hitted && ikParams.LockWeight >= ikParams.PlantLockWeightThreshold;
+
+        if (!hitted)
+        {
+            footState.Weight = 0;
+            return;
+        }
+
+        footState.CurrentLockLocation = IKMath::ResolveIKLocation(
+                ikParams
+            ,   traceResult.ImpactPoint
+            ,   footState.CurrentLockLocation
+            ,   ikParams.LockWeight
+        );
+        footState.ImpactPoint = traceResult.ImpactPoint;
+        footState.HitNormal = traceResult.Normal;
+        footState.EffectorAddtiveRotation = ikParams.AlignEffectorBoneToSurface ?
+                IKMath::ResolveSurfaceAlignment(ikParams, traceResult.Normal)
+            :   FRotator::ZeroRotator;
+        footState.Weight = ikParams.Weight;
+        footState.FinalIKLocation = transform.InverseTransformPosition(footState.CurrentLockLocation);
+    }
+}
+
+/*****
+* SOLVE
+******/
+UMassIKFootPlacementProcessor::UMassIKFootPlacementProcessor()
+{
+    this->ExecutionFlags = (int32)(EProcessorExecutionFlags::Client | EProcessorExecutionFlags::Standalone);
+    this->ExecutionOrder.ExecuteAfter.Add(UE::Mass::ProcessorGroupNames::Movement);
+    this->ExecutionOrder.ExecuteAfter.Add(UMassIKActorSyncProcessor::StaticClass()->GetFName());
+}
+
+void UMassIKFootPlacementProcessor::ConfigureQueries()
+{
+    this->EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly);
+    this->EntityQuery.AddRequirement<FMassIKFootPlacementFragment>(EMassFragmentAccess::ReadWrite);
+    this->EntityQuery.AddRequirement<FMassRepresentationLODFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+    this->EntityQuery.AddConstSharedRequirement<FMassIKFootPlacementConfigFragment>();
+    this->EntityQuery.RegisterWithProcessor(*this);
+}
+
+void UMassIKFootPlacementProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+    UWorld* world = EntityManager.GetWorld();
+
+    if (!world)
+    {
+        return;
+    }
+
+    UIKGroundQueryCache* cache = world->GetSubsystem<UIKGroundQueryCache>();
+
+    this->EntityQuery.ParallelForEachEntityChunk(EntityManager, Context, [world, cache](FMassExecutionContext& chunkContext)
+    {
+        const FMassIKFootPlacementConfigFragment& config = chunkContext.GetConstSharedFragment<FMassIKFootPlacementConfigFragment>();
+
+        if (config.GroundSource == EIKGroundSource::NavMesh)
+        {
+            return;
+        }
+
+        TConstArrayView<FTransformFragment> transforms = chunkContext.GetFragmentView<FTransformFragment>();
+        TArrayView<FMassIKFootPlacementFragment> placements = chunkContext.GetMutableFragmentView<FMassIKFootPlacementFragment>();
+        TConstArrayView<FMassRepresentationLODFragment> lods = chunkContext.GetFragmentView<FMassRepresentationLODFragment>();
+
+        FIKGroundQueryParams queryParams;
+        queryParams.Build(config.GroundChannel, TArray<AActor*>());
+        queryParams.Cache = cache;
+
+        int32 numFeet = FMath::Min(config.Feet.Num(), FMassIKFootPlacementFragment::MaxFeet);
+
+        for (int32 entity = 0; entity < chunkContext.GetNumEntities(); entity++)
+        {
+            FMassIKFootPlacementFragment& placement = placements[entity];
+
+            if (!ShouldSolve(placement, lods, entity))
+            {
+                continue;
+            }
+
+            const FTransform& transform = transforms[entity].GetTransform();
+
+            for (int32 foot = 0; foot < numFeet; foot++)
+            {
+                const FIKParams& ikParams = config.Feet[foot].Params;
+                FMassIKFootState& footState = placement.Feet[foot];
+
+                FVector startTrace = ResolveFootStartTrace(config.Feet[foot], transform, footState);
+
+                FHitResult traceResult;
+                bool hitted = FIKGroundQuery::Trace(
+                        world
+                    ,   ikParams
+                    ,   startTrace
+                    ,   footState.ImpactPoint
+                    ,   ikParams.GroundQueryMode
+                    ,   queryParams
+                    ,   traceResult
+                );
+
+                ApplyFootHit(ikParams, transform, hitted, traceResult, footState);
+            }
+        }
+    });
+}
+
+/**********
+* NAV SOLVE
+***********/
+UMassIKNavFootPlacementProcessor::UMassIKNavFootPlacementProcessor()
+{
+    this->ExecutionFlags = (int32)(EProcessorExecutionFlags::Client | EProcessorExecutionFlags::Standalone);
+    this->ExecutionOrder.ExecuteAfter.Add(UE::Mass::ProcessorGroupNames::Movement);
+    this->ExecutionOrder.ExecuteAfter.Add(UMassIKActorSyncProcessor::StaticClass()->GetFName());
+    this->bRequiresGameThreadExecution = true;
+}
+
+void UMassIKNavFootPlacementProcessor::ConfigureQueries()
+{
+    this->EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly);
+    this->EntityQuery.AddRequirement<FMassIKFootPlacementFragment>(EMassFragmentAccess::ReadWrite);
+    this->EntityQuery.AddRequirement<FMassRepresentationLODFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+    this->EntityQuery.AddConstSharedRequirement<FMassIKFootPlacementConfigFragment>();
+    this->EntityQuery.RegisterWithProcessor(*this);
+}
+
+void UMassIKNavFootPlacementProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+    UWorld* world = EntityManager.GetWorld();
+
+    if (!world)
+    {
+        return;
+    }
+
+    UIKGroundQueryCache* cache = world->GetSubsystem<UIKGroundQueryCache>();
+
+    TArray<FIKNavGroundQuery> queries;
+    TArray<TPair<int32, int32>> queryFeet;
+
+    this->EntityQuery.ForEachEntityChunk(EntityManager, Context, [world, cache, &queries, &queryFeet](FMassExecutionContext& chunkContext)
+    {
+        const FMassIKFootPlacementConfigFragment& config = chunkContext.GetConstSharedFragment<FMassIKFootPlacementConfigFragment>();
+
+        if (config.GroundSource != EIKGroundSource::NavMesh)
+        {
+            return;
+        }
+
+        TConstArrayView<FTransformFragment> transforms = chunkContext.GetFragmentView<FTransformFragment>();
+        TArrayView<FMassIKFootPlacementFragment> placements = chunkContext.GetMutableFragmentView<FMassIKFootPlacementFragment>();
+        TConstArrayView<FMassRepresentationLODFragment> lods = chunkContext.GetFragmentView<FMassRepresentationLODFragment>();
+
+        int32 numFeet = FMath::Min(config.Feet.Num(), FMassIKFootPlacementFragment::MaxFeet);
+
+        queries.Reset();
+        queryFeet.Reset();
+
+        for (int32 entity = 0; entity < chunkContext.GetNumEntities(); entity++)
+        {
+            if (!ShouldSolve(placements[entity], lods, entity))
+            {
+                continue;
+            }
+
+            for (int32 foot = 0; foot < numFeet; foot++)
+            {
+                const FIKParams& ikParams = config.Feet[foot].Params;
+
+                FIKNavGroundQuery& query = queries.AddDefaulted_GetRef();
+                query.StartTrace = ResolveFootStartTrace(config.Feet[foot], transforms[entity].GetTransform(), placements[entity].Feet[foot]);
+                query.TraceDirection = ikParams.TraceDirection;
+                query.TraceLength = ikParams.TraceLength;
+                query.TraceRadius = ikParams.TraceRadius;
+
+                queryFeet.Emplace(entity, foot);
+            }
+        }
+
+        FIKNavGroundProjection::ProjectBatch(world, queries, config.NavMeshMaxSurfaceAngle);
+
+        FIKGroundQueryParams queryParams;
+        queryParams.Build(config.GroundChannel, TArray<AActor*>());
+        queryParams.Cache = cache;
+
+        for (int32 index = 0; index < queries.Num(); index++)
+        {
+            int32 entity = queryFeet[index].Key;
+            int32 foot = queryFeet[index].Value;
+            const FIKParams& ikParams = config.Feet[foot].Params;
+            FMassIKFootState& footState = placements[entity].Feet[foot];
+
+            FHitResult traceResult;
+            bool hitted = queries[index].Hitted;
+
+            if (hitted)
+            {
+                FIKNavGroundProjection::BuildHitResult(queries[index], traceResult);
+            }
+            else
+            {
+                hitted = FIKGroundQuery::Trace(
+                        world
+                    ,   ikParams
+                    ,   queries[index].StartTrace
+                    ,   footState.ImpactPoint
+                    ,   ikParams.GroundQueryMode
+                    ,   queryParams
+                    ,   traceResult
+                );
+            }
+
+            ApplyFootHit(ikParams, transforms[entity].GetTransform(), hitted, traceResult, footState);
+        }
+    });
+}
+
+/****************
+* ACTOR PROMOTION
+*****************/
+UMassIKActorSyncProcessor::UMassIKActorSyncProcessor()
+{
+    this->ExecutionFlags = (int32)(EProcessorExecutionFlags::Client | EProcessorExecutionFlags::Standalone);
+    this->ExecutionOrder.ExecuteAfter.Add(UE::Mass::ProcessorGroupNames::Representation);
+    this->bRequiresGameThreadExecution = true;
+}
+
+void UMassIKActorSyncProcessor::ConfigureQueries()
+{
+    this->EntityQuery.AddRequirement<FMassIKFootPlacementFragment>(EMassFragmentAccess::ReadWrite);
+    this->EntityQuery.AddRequirement<FMassActorFragment>(EMassFragmentAccess::ReadWrite);
+    this->EntityQuery.AddConstSharedRequirement<FMassIKFootPlacementConfigFragment>();
+    this->EntityQuery.RegisterWithProcessor(*this);
+}
+
+void UMassIKActorSyncProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+    this->EntityQuery.ForEachEntityChunk(EntityManager, Context, [](FMassExecutionContext& chunkContext)
+    {
+        const FMassIKFootPlacementConfigFragment& config = chunkContext.GetConstSharedFragment<FMassIKFootPlacementConfigFragment>();
+        TArrayView<FMassIKFootPlacementFragment> placements = chunkContext.GetMutableFragmentView<FMassIKFootPlacementFragment>();
+        TArrayView<FMassActorFragment> actors = chunkContext.GetMutableFragmentView<FMassActorFragment>();
+
+        for (int32 entity = 0; entity < chunkContext.GetNumEntities(); entity++)
+        {
+            FMassIKFootPlacementFragment& placement = placements[entity];
+            ABase* character = Cast<ABase>(actors[entity].GetMutable());
+            UBaseAnimInstance* animInstance = character ? 
+                    Cast<UBaseAnimInstance>(character->GetMesh()->GetAnimInstance()) 
+                :   nullptr;
+
+            // Demoted, the fragment keeps the last state mirrored from the actor
+            if (!animInstance)
+            {
+                placement.RepresentedByActor = false;
+                continue;
+            }
+
+            // Promoted, the actor starts from the entity state instead of popping
+            if (!placement.RepresentedByActor)
+            {
+                config.CopyToAnimInstance(placement, *animInstance);
+                placement.RepresentedByActor = true;
+                continue;
+            }
+
+            config.CopyFromAnimInstance(*animInstance, placement);
+        }
+    });
+}
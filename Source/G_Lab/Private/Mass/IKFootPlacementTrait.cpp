@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/IKFootPlacementTrait.h"
+
+#include "MassCommonFragments.h"
+#include "MassEntityTemplateRegistry.h"
+#include "MassEntityUtils.h"
+
+void UMassIKFootPlacementTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+    FMassEntityManager& entityManager = UE::Mass::Utils::GetEntityManagerChecked(World);
+
+    if (this->Config.Feet.Num() > FMassIKFootPlacementFragment::MaxFeet)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("IK foot placement: only the first %d feet are solved"), FMassIKFootPlacementFragment::MaxFeet);
+    }
+
+    BuildContext.RequireFragment<FTransformFragment>();
+    BuildContext.AddFragment<FMassIKFootPlacementFragment>();
+
+    const FConstSharedStruct configFragment = entityManager.GetOrCreateConstSharedFragment(this->Config);
+    BuildContext.AddConstSharedFragment(configFragment);
+}
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/BaseAnimSharingSubsystem.h"
+
+#include "G_Lab.h"
+#include "Components/AnimInstances/BaseAnimInstance.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Sharing Instances"), STAT_GLab_AnimSharingInstances, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Sharing Leaders"), STAT_GLab_AnimSharingLeaders, STATGROUP_GLab);
+
+void UBaseAnimSharingSubsystem::Register(UBaseAnimInstance* animInstance)
+{
+    if (animInstance)
+    {
+        this->Instances.AddUnique(animInstance);
+    }
+}
+
+void UBaseAnimSharingSubsystem::Unregister(UBaseAnimInstance* animInstance)
+{
+    if (!animInstance || this->Instances.RemoveSwap(animInstance) == 0)
+    {
+        return;
+    }
+
+    animInstance->SetSharedLocomotionLeader(nullptr, false);
+
+    // Followers of a removed leader evaluate themselves until the next reassignment
+    for (UBaseAnimInstance* instance : this->Instances)
+    {
+        if (instance && instance->SharedLocomotionLeader == animInstance->GetOwningComponent())
+        {
+            instance->SetSharedLocomotionLeader(nullptr, false);
+        }
+    }
+}
+
+int32 UBaseAnimSharingSubsystem::GetNumLeaders() const
+{
+    return this->NumLeaders;
+}
+
+void UBaseAnimSharingSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    this->TimeSinceReassign += DeltaTime;
+
+    if (this->TimeSinceReassign < this->ReassignInterval)
+    {
+        return;
+    }
+
+    this->TimeSinceReassign = 0;
+    this->ReassignLeaders();
+}
+
+uint32 UBaseAnimSharingSubsystem::GetLocomotionStateKey(const UBaseAnimInstance* animInstance) const
+{
+    uint32 speedBucket = FMath::FloorToInt32(animInstance->LastVelocity.Length() / FMath::Max(this->SpeedBucketSize, 1.f));
+
+    return (FMath::Min(speedBucket, 0xFFFFu))
+        | (animInstance->IsStopping << 16)
+        | (animInstance->IsAccelerating << 17)
+        | (animInstance->IsDecelerating << 18)
+        | (animInstance->IsTransitioning << 19);
+}
+
+void UBaseAnimSharingSubsystem::ReassignLeaders()
+{
+    TMap<TPair<const USkeleton*, uint32>, TArray<UBaseAnimInstance*>> groups;
+
+    for (UBaseAnimInstance* instance : this->Instances)
+    {
+        if (!instance || !instance->GetOwningComponent())
+        {
+            continue;
+        }
+
+        groups.FindOrAdd({ instance->CurrentSkeleton, this->GetLocomotionStateKey(instance) }).Add(instance);
+    }
+
+    this->NumLeaders = 0;
+
+    for (TPair<TPair<const USkeleton*, uint32>, TArray<UBaseAnimInstance*>>& group : groups)
+    {
+        TArray<UBaseAnimInstance*>& members = group.Value;
+
+        // Nobody to share with, a lone instance keeps its own ticking and is not counted as a leader
+        if (members.Num() == 1)
+        {
+            members[0]->SetSharedLocomotionLeader(nullptr, false);
+            continue;
+        }
+
+        // Keep the current leader while it stays in the group, otherwise prefer a visible one
+        UBaseAnimInstance* leader = nullptr;
+        for (UBaseAnimInstance* member : members)
+        {
+            if (member->IsSharedLocomotionLeader)
+            {
+                leader = member;
+                break;
+            }
+
+            if (!leader && member->GetOwningComponent()->WasRecentlyRendered())
+            {
+                leader = member;
+            }
+        }
+
+        if (!leader)
+        {
+            leader = members[0];
+        }
+
+        for (UBaseAnimInstance* member : members)
+        {
+            if (member == leader)
+            {
+                member->SetSharedLocomotionLeader(nullptr, true);
+            }
+            else
+            {
+                member->SetSharedLocomotionLeader(leader->GetOwningComponent(), false);
+            }
+        }
+
+        this->NumLeaders++;
+    }
+
+    SET_DWORD_STAT(STAT_GLab_AnimSharingInstances, this->Instances.Num());
+    SET_DWORD_STAT(STAT_GLab_AnimSharingLeaders, this->NumLeaders);
+}
+
+TStatId UBaseAnimSharingSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UBaseAnimSharingSubsystem, STATGROUP_Tickables);
+}
+
+bool UBaseAnimSharingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/BaseCrowdTickSubsystem.h"
+
+#include "G_Lab.h"
+#include "Entities/Characters/Base.h"
+
+DECLARE_CYCLE_STAT(TEXT("Crowd Batched Tick"), STAT_GLab_CrowdBatchedTick, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crowd Batched Characters"), STAT_GLab_CrowdBatchedCharacters, STATGROUP_GLab);
+
+void UBaseCrowdTickSubsystem::Register(ABase* character)
+{
+    if (!character || character->BatchedTickIndex != INDEX_NONE)
+    {
+        return;
+    }
+
+    character->BatchedTickIndex = this->Characters.Add(character);
+}
+
+void UBaseCrowdTickSubsystem::Unregister(ABase* character)
+{
+    if (!character || !this->Characters.IsValidIndex(character->BatchedTickIndex))
+    {
+        return;
+    }
+
+    int32 index = character->BatchedTickIndex;
+    this->Characters.RemoveAtSwap(index, 1, EAllowShrinking::No);
+
+    if (this->Characters.IsValidIndex(index))
+    {
+        this->Characters[index]->BatchedTickIndex = index;
+    }
+
+    character->BatchedTickIndex = INDEX_NONE;
+}
+
+int32 UBaseCrowdTickSubsystem::GetNumCharacters() const
+{
+    return this->Characters.Num();
+}
+
+void UBaseCrowdTickSubsystem::Tick(float DeltaTime)
+{
+    SCOPE_CYCLE_COUNTER(STAT_GLab_CrowdBatchedTick);
+    SET_DWORD_STAT(STAT_GLab_CrowdBatchedCharacters, this->Characters.Num());
+
+    Super::Tick(DeltaTime);
+
+    for (int32 index = 0; index < this->Characters.Num(); index++)
+    {
+        ABase* character = this->Characters[index];
+
+        if (character && !character->IsActorBeingDestroyed())
+        {
+            character->BatchedTick(DeltaTime * character->CustomTimeDilation);
+        }
+    }
+}
+
+TStatId UBaseCrowdTickSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UBaseCrowdTickSubsystem, STATGROUP_Tickables);
+}
+
+bool UBaseCrowdTickSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,209 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/IKBudgetSubsystem.h"
+
+#include "G_Lab.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("IK Budget (ms)"), STAT_GLab_IKBudgetMs, STATGROUP_GLab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("IK Budget Used (ms)"), STAT_GLab_IKBudgetUsedMs, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Tier Full"), STAT_GLab_IKTierFull, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Tier Feet Only"), STAT_GLab_IKTierFeetOnly, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Tier Cached"), STAT_GLab_IKTierCached, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Tier Off"), STAT_GLab_IKTierOff, STATGROUP_GLab);
+
+static TAutoConsoleVariable<bool> CVarIKBudgetEnabled(
+    TEXT("GLab.IKBudget.Enabled"),
+    true,
+    TEXT("Assigns IK quality tiers under GLab.IKBudget.BudgetMs, when disabled every instance solves at full quality."),
+    ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarIKBudgetMs(
+    TEXT("GLab.IKBudget.BudgetMs"),
+    1.0f,
+    TEXT("Game thread and worker milliseconds per frame shared by the IK solve of every character."),
+    ECVF_Default
+);
+
+void UIKBudgetSubsystem::Register(UBaseAnimInstance* animInstance)
+{
+    if (animInstance)
+    {
+        this->Instances.AddUnique(animInstance);
+    }
+}
+
+void UIKBudgetSubsystem::Unregister(UBaseAnimInstance* animInstance)
+{
+    this->Instances.RemoveSwap(animInstance);
+}
+
+void UIKBudgetSubsystem::ReportCost(EIKQualityTier tier, uint64 cycles)
+{
+    this->FrameCycles[(int32)tier] += cycles;
+    this->FrameSolves[(int32)tier]++;
+}
+
+float UIKBudgetSubsystem::GetUsedMs() const
+{
+    return this->UsedMs;
+}
+
+int32 UIKBudgetSubsystem::GetNumInstancesInTier(EIKQualityTier tier) const
+{
+    return this->TierCounts[(int32)tier];
+}
+
+void UIKBudgetSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    this->UsedMs = 0;
+
+    for (int32 tier = 0; tier < NumTiers; tier++)
+    {
+        uint64 cycles = this->FrameCycles[tier].exchange(0);
+        int32 solves = this->FrameSolves[tier].exchange(0);
+
+        if (solves == 0)
+        {
+            continue;
+        }
+
+        float frameMs = FPlatformTime::ToMilliseconds64(cycles);
+        this->TierCostMs[tier] = FMath::Lerp(this->TierCostMs[tier], frameMs / solves, this->CostSmoothing);
+        this->UsedMs += frameMs;
+    }
+
+    this->AssignTiers();
+
+    SET_FLOAT_STAT(STAT_GLab_IKBudgetMs, CVarIKBudgetMs.GetValueOnGameThread());
+    SET_FLOAT_STAT(STAT_GLab_IKBudgetUsedMs, this->UsedMs);
+    SET_DWORD_STAT(STAT_GLab_IKTierFull, this->TierCounts[(int32)EIKQualityTier::Full]);
+    SET_DWORD_STAT(STAT_GLab_IKTierFeetOnly, this->TierCounts[(int32)EIKQualityTier::FeetOnly]);
+    SET_DWORD_STAT(STAT_GLab_IKTierCached, this->TierCounts[(int32)EIKQualityTier::Cached]);
+    SET_DWORD_STAT(STAT_GLab_IKTierOff, this->TierCounts[(int32)EIKQualityTier::Off]);
+}
+
+void UIKBudgetSubsystem::AssignTiers()
+{
+    FMemory::Memzero(this->TierCounts);
+
+    if (!CVarIKBudgetEnabled.GetValueOnGameThread())
+    {
+        for (UBaseAnimInstance* instance : this->Instances)
+        {
+            if (instance)
+            {
+                instance->IKQualityTier = EIKQualityTier::Full;
+                this->TierCounts[(int32)EIKQualityTier::Full]++;
+            }
+        }
+
+        return;
+    }
+
+    TArray<FVector, TInlineAllocator<4>> viewLocations;
+    for (FConstPlayerControllerIterator iterator = this->GetWorld()->GetPlayerControllerIterator(); iterator; ++iterator)
+    {
+        APlayerController* playerController = iterator->Get();
+
+        if (playerController && playerController->IsLocalController())
+        {
+            FVector viewLocation;
+            FRotator viewRotation;
+            playerController->GetPlayerViewPoint(viewLocation, viewRotation);
+            viewLocations.Add(viewLocation);
+        }
+    }
+
+    TArray<TPair<float, UBaseAnimInstance*>> ranked;
+    ranked.Reserve(this->Instances.Num());
+
+    for (UBaseAnimInstance* instance : this->Instances)
+    {
+        if (instance && instance->GetOwningComponent() && IsBudgeted(instance))
+        {
+            ranked.Emplace(this->GetSignificance(instance, viewLocations), instance);
+        }
+    }
+
+    ranked.Sort([](const TPair<float, UBaseAnimInstance*>& a, const TPair<float, UBaseAnimInstance*>& b)
+    {
+        return a.Key > b.Key;
+    });
+
+    /***********************
+    * MOST SIGNIFICANT FIRST
+    ************************/
+    float remainingMs = CVarIKBudgetMs.GetValueOnGameThread();
+    double timeSeconds = this->GetWorld()->GetTimeSeconds();
+
+    for (TPair<float, UBaseAnimInstance*>& entry : ranked)
+    {
+        UBaseAnimInstance* instance = entry.Value;
+        bool rendered = instance->GetOwningComponent()->WasRecentlyRendered();
+        EIKQualityTier tier = rendered ? EIKQualityTier::Cached : EIKQualityTier::Off;
+
+        for (EIKQualityTier candidate : { EIKQualityTier::Full, EIKQualityTier::FeetOnly })
+        {
+            if (this->TierCostMs[(int32)candidate] <= remainingMs)
+            {
+                tier = candidate;
+                break;
+            }
+        }
+
+        if (tier != instance->IKQualityTier)
+        {
+            if (timeSeconds - instance->IKQualityTierChangeTime < this->MinTierTime)
+            {
+                tier = instance->IKQualityTier;
+            }
+            else
+            {
+                instance->IKQualityTierChangeTime = timeSeconds;
+            }
+        }
+
+        remainingMs -= this->TierCostMs[(int32)tier];
+
+        instance->IKQualityTier = tier;
+        this->TierCounts[(int32)tier]++;
+    }
+}
+
+bool UIKBudgetSubsystem::IsBudgeted(const UBaseAnimInstance* animInstance)
+{
+    return !animInstance->IsSleeping && animInstance->IKExecutionContext == EIKExecutionContext::Full;
+}
+
+float UIKBudgetSubsystem::GetSignificance(const UBaseAnimInstance* animInstance, TConstArrayView<FVector> viewLocations) const
+{
+    USkeletalMeshComponent* body = animInstance->GetOwningComponent();
+
+    float nearestDistance = viewLocations.Num() > 0 ? TNumericLimits<float>::Max() : 0;
+    for (const FVector& viewLocation : viewLocations)
+    {
+        nearestDistance = FMath::Min(nearestDistance, FVector::Distance(viewLocation, body->GetComponentLocation()));
+    }
+
+    float significance = 1 / (1 + nearestDistance / FMath::Max(this->SignificanceDistance, 1.f));
+
+    // Off screen characters only keep what is left after the visible ones
+    return body->WasRecentlyRendered() ? significance + 1 : significance;
+}
+
+TStatId UIKBudgetSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UIKBudgetSubsystem, STATGROUP_Tickables);
+}
+
+bool UIKBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/IKContactSubsystem.h"
+
+void UIKContactSubsystem::Publish(const FIKContactEvent& contactEvent)
+{
+    this->PendingEvents.Enqueue(contactEvent);
+}
+
+const TArray<FIKContactEvent>& UIKContactSubsystem::GetLastFrameEvents() const
+{
+    return this->DrainedEvents;
+}
+
+void UIKContactSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    this->DrainedEvents.Reset();
+
+    FIKContactEvent currentEvent;
+    while (this->PendingEvents.Dequeue(currentEvent))
+    {
+        this->DrainedEvents.Add(currentEvent);
+    }
+
+    if (this->DrainedEvents.Num() > 0)
+    {
+        this->OnContactEvents.Broadcast(this->DrainedEvents);
+    }
+}
+
+TStatId UIKContactSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UIKContactSubsystem, STATGROUP_Tickables);
+}
+
+bool UIKContactSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/IKGroundQueryCache.h"
+
+#include "G_Lab.h"
+#include "CollisionQueryParams.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/HitResult.h"
+#include "GameFramework/Pawn.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Cache Entries"), STAT_GLab_IKGroundCacheEntries, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Cache Hits"), STAT_GLab_IKGroundCacheHits, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Cache Misses"), STAT_GLab_IKGroundCacheMisses, STATGROUP_GLab);
+DECLARE_DWORD_COUNTER_STAT(TEXT("IK Ground Cache Invalidations"), STAT_GLab_IKGroundCacheInvalidations, STATGROUP_GLab);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("IK Ground Cache Hit Rate"), STAT_GLab_IKGroundCacheHitRate, STATGROUP_GLab);
+
+FIKGroundQueryCacheKey UIKGroundQueryCache::MakeKey(
+        const FVector& startTrace
+    ,   const FVector& traceDirection
+    ,   float traceRadius
+    ,   float traceLength
+    ,   ECollisionChannel channel
+    ,   uint8 queryMode
+) const
+{
+    double cellSize = FMath::Max(this->CellSize, 0.1f);
+
+    FIKGroundQueryCacheKey key;
+    key.Origin = FIntVector(
+            FMath::FloorToInt32(startTrace.X / cellSize)
+        ,   FMath::FloorToInt32(startTrace.Y / cellSize)
+        ,   FMath::FloorToInt32(startTrace.Z / cellSize)
+    );
+    key.Direction = FIntVector(
+            FMath::RoundToInt32(traceDirection.X * 100)
+        ,   FMath::RoundToInt32(traceDirection.Y * 100)
+        ,   FMath::RoundToInt32(traceDirection.Z * 100)
+    );
+    key.Radius = FMath::RoundToInt32(traceRadius);
+    key.Length = FMath::RoundToInt32(traceLength);
+    key.Channel = (uint8)channel;
+    key.QueryMode = queryMode;
+
+    return key;
+}
+
+bool UIKGroundQueryCache::Find(
+        const FIKGroundQueryCacheKey& key
+    ,   const FVector& startTrace
+    ,   const FVector& traceDirection
+    ,   const FCollisionQueryParams& queryParams
+    ,   FHitResult& traceResult
+)
+{
+    FIKGroundQueryCacheEntry entry;
+    {
+        FReadScopeLock readLock(this->EntriesLock);
+
+        const FIKGroundQueryCacheEntry* found = this->Entries.Find(key);
+        if (!found)
+        {
+            this->FrameMisses++;
+            return false;
+        }
+
+        entry = *found;
+    }
+
+    UWorld* world = this->GetWorld();
+    UPrimitiveComponent* hitComponent = entry.HitComponent.Get();
+
+    bool expired = !world || world->GetTimeSeconds() > entry.ExpireTime;
+    bool moved = !hitComponent
+            ||  !hitComponent->GetComponentTransform().Equals(entry.ComponentTransform, UE_KINDA_SMALL_NUMBER);
+
+    if (expired || moved)
+    {
+        this->FrameInvalidations++;
+        this->FrameMisses++;
+        return false;
+    }
+
+    // Characters ignoring the cached actor, usually the one that stored it, must query by themselves
+    AActor* hitActor = hitComponent->GetOwner();
+    if (hitActor && queryParams.GetIgnoredActors().Contains(hitActor->GetUniqueID()))
+    {
+        this->FrameMisses++;
+        return false;
+    }
+
+    FVector impactPoint = startTrace + (traceDirection * entry.Distance);
+
+    traceResult = FHitResult(hitActor, hitComponent, impactPoint, entry.Normal);
+    traceResult.TraceStart = startTrace;
+    traceResult.Location = impactPoint;
+    traceResult.Distance = entry.Distance;
+    traceResult.bBlockingHit = true;
+
+    this->FrameHits++;
+
+    return true;
+}
+
+void UIKGroundQueryCache::Store(const FIKGroundQueryCacheKey& key, const FVector& traceDirection, const FHitResult& traceResult)
+{
+    if (!this->IsCacheable(traceResult))
+    {
+        return;
+    }
+
+    UPrimitiveComponent* hitComponent = traceResult.GetComponent();
+
+    FIKGroundQueryCacheEntry entry;
+    entry.Distance = FVector::DotProduct(traceResult.ImpactPoint - traceResult.TraceStart, traceDirection);
+    entry.Normal = traceResult.ImpactNormal;
+    entry.HitComponent = hitComponent;
+    entry.ComponentTransform = hitComponent->GetComponentTransform();
+    entry.ExpireTime = this->GetWorld()->GetTimeSeconds() + this->TimeToLive;
+
+    FWriteScopeLock writeLock(this->EntriesLock);
+
+    if (this->Entries.Num() >= this->MaxEntries && !this->Entries.Contains(key))
+    {
+        return;
+    }
+
+    this->Entries.Add(key, entry);
+}
+
+bool UIKGroundQueryCache::IsCacheable(const FHitResult& traceResult) const
+{
+    UPrimitiveComponent* hitComponent = traceResult.GetComponent();
+
+    if (!traceResult.bBlockingHit || !hitComponent || !this->GetWorld())
+    {
+        return false;
+    }
+
+    // Pawns move every frame, their entries would be invalidated before anyone reads them
+    return !Cast<APawn>(hitComponent->GetOwner());
+}
+
+float UIKGroundQueryCache::GetHitRate() const
+{
+    return this->LastHitRate;
+}
+
+void UIKGroundQueryCache::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    int32 hits = this->FrameHits.exchange(0);
+    int32 misses = this->FrameMisses.exchange(0);
+    int32 invalidations = this->FrameInvalidations.exchange(0);
+
+    if (hits + misses > 0)
+    {
+        this->LastHitRate = (float)hits / (hits + misses);
+    }
+
+    double timeSeconds = this->GetWorld()->GetTimeSeconds();
+    int32 numEntries = 0;
+    {
+        FWriteScopeLock writeLock(this->EntriesLock);
+
+        for (auto entry = this->Entries.CreateIterator(); entry; ++entry)
+        {
+            if (timeSeconds > entry.Value().ExpireTime || !entry.Value().HitComponent.IsValid())
+            {
+                entry.RemoveCurrent();
+            }
+        }
+
+        numEntries = this->Entries.Num();
+    }
+
+    SET_DWORD_STAT(STAT_GLab_IKGroundCacheEntries, numEntries);
+    SET_DWORD_STAT(STAT_GLab_IKGroundCacheHits, hits);
+    SET_DWORD_STAT(STAT_GLab_IKGroundCacheMisses, misses);
+    SET_DWORD_STAT(STAT_GLab_IKGroundCacheInvalidations, invalidations);
+    SET_FLOAT_STAT(STAT_GLab_IKGroundCacheHitRate, this->LastHitRate);
+}
+
+TStatId UIKGroundQueryCache::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UIKGroundQueryCache, STATGROUP_Tickables);
+}
+
+bool UIKGroundQueryCache::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
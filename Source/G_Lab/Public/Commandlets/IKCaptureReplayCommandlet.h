@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "IKCaptureReplayCommandlet.generated.h"
+
+/**
+ * Replays an IK capture headless and diffs the outputs.
+ * -run=IKCaptureReplay -Capture=<file.ikcap> [-Tolerance=<cm/deg>], a tolerance of 0 requires bit for bit outputs.
+ */
+UCLASS()
+class G_LAB_API UIKCaptureReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual int32 Main(const FString& Params) override;
+
+};
@@ -3,9 +3,62 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include <atomic>
 #include "Animation/AnimInstance.h"
+#include "Components/AnimInstances/IKGroundQueryParams.h"
+#include "Components/AnimInstances/IKNavGroundProjection.h"
 #include "BaseAnimInstance.generated.h"
 
+class ABase;
+class FIKCaptureWriter;
+class UIKBudgetSubsystem;
+
+UENUM(BlueprintType)
+enum class EIKGroundQueryMode : uint8
+{
+	Sweep,
+	Line,
+	Adaptive
+};
+
+UENUM(BlueprintType)
+enum class EIKGroundSource : uint8
+{
+	Physics,
+	NavMesh
+};
+
+UENUM(BlueprintType)
+enum class EIKExecutionContext : uint8
+{
+	Full,
+	ContactOnly,
+	Skipped
+};
+
+UENUM(BlueprintType)
+enum class EIKServerMode : uint8
+{
+	Skip,
+	ContactOnly
+};
+
+UENUM(BlueprintType)
+enum class EIKQualityTier : uint8
+{
+	Full,
+	FeetOnly,
+	Cached,
+	Off
+};
+
+UENUM(BlueprintType)
+enum class EIKSleepMode : uint8
+{
+	FreezePose,
+	ReducedRate
+};
+
 USTRUCT(BlueprintType)
 struct FIKParams 
 {
@@ -21,7 +74,7 @@ public:
 	FName WeightCurveName;
 
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
-	float LockWeight;
+	float LockWeight{ 0 };
 
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	FName LockWeightCurveName;
@@ -76,12 +129,35 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	float TraceRadius;
 
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	EIKGroundQueryMode GroundQueryMode{ EIKGroundQueryMode::Adaptive };
+
+	/** Surface angle, in degrees, above which the adaptive query escalates from a line trace to a sweep */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float SteepSurfaceAngle{ 30 };
+
+	/** Height change from the last lock location that is treated as an edge by the adaptive query */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float EdgeHeightTolerance{ 5 };
+
+	/** Difference between line and sweep impacts that is treated as a step, sampling the footprint */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float StepHeight{ 15 };
+
+	/** Line traces around the trace radius used on steps, 0 keeps the sweep result */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int32 FootprintSamples{ 4 };
+
 	UPROPERTY(BlueprintReadOnly)
 	FVector HitNormal;
 
 	UPROPERTY(BlueprintReadOnly)
 	FVector CurrentLockLocation;
 
+	/** CurrentLockLocation relative to the mesh, rebased every frame the mesh moves */
+	UPROPERTY()
+	FVector3f ComponentLockLocation{ FVector3f::ZeroVector };
+
 	UPROPERTY(BlueprintReadOnly)
 	FRotator EffectorAddtiveRotation;
 
@@ -100,6 +176,21 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	float MaxLength;
 
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float PlantLockWeightThreshold{ 0.5f };
+
+	UPROPERTY(BlueprintReadOnly)
+	bool Planted;
+
+	UPROPERTY(BlueprintReadOnly)
+	FVector ImpactPoint{ FVector::Zero() };
+
+	UPROPERTY(BlueprintReadOnly)
+	float CurrentLockWeight{ 0 };
+
+	UPROPERTY()
+	TWeakObjectPtr<UPrimitiveComponent> HitComponent;
+
 };
 
 USTRUCT(BlueprintType)
@@ -121,28 +212,41 @@ public:
 	): 
 		StartReferenceLocation(reference)
 	,	Location(location)
+	,	Normal(normal)
 	,	Weight(weight)
 	,	Rotation(rotation)
 	,	RotationWeight(rotationWeight)
 	{};
 
 	UPROPERTY()
-	FVector StartReferenceLocation;
+	FVector StartReferenceLocation{ FVector::Zero() };
 
 	UPROPERTY()
-	FVector Location;
+	FVector Location{ FVector::Zero() };
 
 	UPROPERTY()
-	FRotator Rotation;
+	FRotator Rotation{ FRotator::ZeroRotator };
 
 	UPROPERTY()
-	FVector Normal;
+	FVector Normal{ FVector::UpVector };
 
 	UPROPERTY()
-	float Weight;
+	float Weight{ 0 };
 
 	UPROPERTY()
-	float RotationWeight;
+	float RotationWeight{ 0 };
+
+	UPROPERTY()
+	float LockWeight{ 0 };
+
+	UPROPERTY()
+	FVector ImpactPoint{ FVector::Zero() };
+
+	UPROPERTY()
+	FVector3f ComponentLocation{ FVector3f::ZeroVector };
+
+	UPROPERTY()
+	TWeakObjectPtr<UPrimitiveComponent> HitComponent;
 
 };
 
@@ -177,6 +281,61 @@ public:
 
 };
 
+/** Stable reference to an entry of UBaseAnimInstance::IKParams, resolved once instead of by name every update */
+USTRUCT(BlueprintType)
+struct FIKHandle
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintReadOnly)
+	FName IKName;
+
+	int32 Index{ INDEX_NONE };
+
+	bool IsValid() const { return this->Index != INDEX_NONE; }
+};
+
+USTRUCT(BlueprintType)
+struct FBaseVelocityStats
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintReadOnly)
+	bool IsStopping{ false };
+
+	UPROPERTY(BlueprintReadOnly)
+	bool IsDecelerating{ false };
+
+	UPROPERTY(BlueprintReadOnly)
+	bool IsAccelerating{ false };
+
+	UPROPERTY(BlueprintReadOnly)
+	FVector LastVelocity{ FVector::Zero() };
+
+	void Update(const FVector& velocity, float idleMoveThreshold);
+};
+
+USTRUCT()
+struct FBaseLinkedLayerState
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	TSubclassOf<UAnimInstance> LayerClass;
+
+	UPROPERTY()
+	bool Active{ false };
+
+	UPROPERTY()
+	double InactiveSince{ 0 };
+};
+
 USTRUCT(BlueprintType, Blueprintable)
 struct FTransitIKParams 
 {
@@ -213,13 +372,27 @@ public:
 	/*****
 	* IKs
 	*****/
+	/** Solved in the component space of the last UpdateIKs */
 	UFUNCTION(BlueprintCallable)
 	FIKData GetIKData(const FIKParams& ikParams, bool& hitted);
 
 	UFUNCTION(BlueprintCallable)
 	TArray<FIKParams> UpdateIKs();
 
+	/** UpdateIKs for thread safe update functions, read the results by handle instead of copying them */
+	UFUNCTION(BlueprintCallable, meta = (BlueprintThreadSafe))
+	void UpdateIKsThreadSafe();
+
+	virtual void NativeInitializeAnimation() override;
+
+	virtual void NativeUninitializeAnimation() override;
+
+	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
+
 	void UpdateRoots();
+
+	/** Rebuilds the component space locks from the world ones on the next update, after writing CurrentLockLocation */
+	void InvalidateIKComponentSpace();
 	
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category="Settings|IKs")
 	TMap<FName, FIKParams> IKParams;
@@ -239,6 +412,141 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
 	TArray<FIKRoots> IKRoots;
 
+	/*************
+	* IK ACCESSORS
+	**************/
+	UFUNCTION(BlueprintPure, meta = (BlueprintThreadSafe))
+	FIKHandle GetIKHandle(FName ikName) const;
+
+	const FIKParams* FindIKParams(const FIKHandle& handle) const;
+
+	UFUNCTION(BlueprintPure, meta = (BlueprintThreadSafe))
+	FVector GetIKFinalLocation(const FIKHandle& handle) const;
+
+	UFUNCTION(BlueprintPure, meta = (BlueprintThreadSafe))
+	FRotator GetIKEffectorRotation(const FIKHandle& handle) const;
+
+	UFUNCTION(BlueprintPure, meta = (BlueprintThreadSafe))
+	float GetIKWeight(const FIKHandle& handle) const;
+
+	UFUNCTION(BlueprintPure, meta = (BlueprintThreadSafe))
+	float GetIKRotationWeight(const FIKHandle& handle) const;
+
+	UFUNCTION(BlueprintPure, meta = (BlueprintThreadSafe))
+	bool IsIKHitted(const FIKHandle& handle) const;
+
+	/** Root offset of IKRoots[rootIndex], zero while the root does not need to move */
+	UFUNCTION(BlueprintPure, meta = (BlueprintThreadSafe))
+	FVector GetIKRootLocation(int32 rootIndex) const;
+
+	UFUNCTION(BlueprintCallable, meta = (BlueprintThreadSafe))
+	void SetIKReverseMaskStartTraceLocation(const FIKHandle& handle, FVector newLocation);
+
+	/******************
+	* EXECUTION CONTEXT
+	*******************/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	EIKServerMode DedicatedServerIKMode{ EIKServerMode::Skip };
+
+	/** Drops to contact only, or skips, while the mesh is not rendered and its bones are not refreshed */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	bool SkipIKWhenNotRendered{ true };
+
+	UPROPERTY(BlueprintReadOnly)
+	EIKExecutionContext IKExecutionContext{ EIKExecutionContext::Full };
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	EIKExecutionContext ResolveIKExecutionContext() const;
+
+	/*******
+	* BUDGET
+	********/
+	/** Lets the world UIKBudgetSubsystem lower IKQualityTier when the frame IK budget runs out */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	bool UseIKBudget{ true };
+
+	/** Full solves everything, FeetOnly skips surface alignment and roots, Cached keeps the last targets */
+	UPROPERTY(BlueprintReadOnly, Transient)
+	EIKQualityTier IKQualityTier{ EIKQualityTier::Full };
+
+	/** World time of the last IKQualityTier change, written by UIKBudgetSubsystem */
+	double IKQualityTierChangeTime{ 0 };
+
+	/******
+	* SLEEP
+	*******/
+	/** Stops the IK and drops the mesh update once the character rests with stable IK targets */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Sleep")
+	bool UseSettledSleep{ true };
+
+	/** Consecutive settled solves before sleeping */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Sleep")
+	int32 SettledFrameCount{ 30 };
+
+	/** Largest lock movement, in component space, still treated as a stable IK target */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Sleep")
+	float SettledTargetTolerance{ 0.5f };
+
+	/** FreezePose keeps the last pose, ReducedRate keeps evaluating idle animations at SleepTickInterval */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Sleep")
+	EIKSleepMode SleepMode{ EIKSleepMode::FreezePose };
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Sleep")
+	float SleepTickInterval{ 0.25f };
+
+	UPROPERTY(BlueprintReadOnly, Transient)
+	bool IsSleeping;
+
+	/** Game thread, enters or leaves the sleep, the mesh does not tick this instance while frozen */
+	void UpdateSettledSleep();
+
+	/** For notifies or gameplay that need full updates, the settled count starts over */
+	UFUNCTION(BlueprintCallable)
+	void WakeFromSleep();
+
+	/*************
+	* GROUND QUERY
+	**************/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	TEnumAsByte<ECollisionChannel> IKGroundChannel{ ECollisionChannel::ECC_GameTraceChannel1 };
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	TArray<TObjectPtr<AActor>> IKIgnoredActors;
+
+	/** Reuses ground hits of nearby characters through the world UIKGroundQueryCache */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	bool UseSharedGroundQueryCache{ true };
+
+	UFUNCTION(BlueprintCallable)
+	void RefreshIKQueryParams();
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	EIKGroundSource IKGroundSource{ EIKGroundSource::Physics };
+
+	/** Mesh LOD from which the navmesh is used as ground source regardless of IKGroundSource, -1 disables it */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	int32 NavMeshGroundSourceMinLOD{ INDEX_NONE };
+
+	/** Nav polys steeper than this, usually ramps generated over stairs, fall back to physics */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	float NavMeshMaxSurfaceAngle{ 20 };
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	EIKGroundSource GetActiveIKGroundSource() const;
+
+	bool TraceIKGround(const FIKParams& ikParams, const FVector& startTrace, FHitResult& traceResult) const;
+
+	/** IK names sorted lexically, the foot order of the replicated contacts and of every solve */
+	const TArray<FName>& GetIKNamesInReplicationOrder() const;
+
+	/***************
+	* CONTACT EVENTS
+	****************/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|IKs")
+	bool PublishContactEvents{ true };
+
+	void PublishContactEvent(FName ikName, const FIKParams& ikParams);
+
 	/***************
 	* VELOCITY STATS
 	****************/
@@ -254,18 +562,60 @@ public:
 	UPROPERTY(BlueprintReadOnly)
 	bool IsAccelerating;
 
+	/** No-op while ComputeVelocityStatsInProxy, the stats are already resolved on the anim worker */
 	UFUNCTION(BlueprintCallable)
 	void UpdateVelocityStats();
 
 	UPROPERTY()
 	FVector LastVelocity{ FVector::Zero() };
 
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Movement")
+	bool ComputeVelocityStatsInProxy{ true };
+
+	/** Stats of the current update, fresh on the anim worker before the instance properties are written back */
+	UFUNCTION(BlueprintPure, meta = (BlueprintThreadSafe))
+	FBaseVelocityStats GetVelocityStats() const;
+
+	FBaseVelocityStats GetInstanceVelocityStats() const;
+
+	void SetInstanceVelocityStats(const FBaseVelocityStats& velocityStats);
+
+	/*****************
+	* ANIMATION SHARING
+	******************/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Sharing")
+	bool UseAnimationSharing;
+
+	/** Set on graphs whose locomotion copies SharedLocomotionLeader, others are never grouped so leaders keep their tick options */
+	UPROPERTY(EditDefaultsOnly, Category = "Settings|Sharing")
+	bool LocomotionCopiesSharedLeader;
+
+	/** Set while following, the locomotion layer should copy this mesh pose instead of evaluating its own */
+	UPROPERTY(BlueprintReadOnly, Transient)
+	TObjectPtr<USkeletalMeshComponent> SharedLocomotionLeader;
+
+	UPROPERTY(BlueprintReadOnly, Transient)
+	bool IsSharedLocomotionLeader;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true, meta = (BlueprintThreadSafe))
+	bool IsSharedLocomotionFollower() const;
+
+	void SetSharedLocomotionLeader(USkeletalMeshComponent* leader, bool leadsFollowers);
+
 	/***********
 	* TRANSITION
 	************/
+	/** Read by the IK solve of the state owner, layers go through SetIKTransitioning / IsIKTransitioning */
 	UPROPERTY(BlueprintReadWrite)
 	bool IsTransitioning;
 
+	/** Sets the transitioning flag on the IK state owner */
+	UFUNCTION(BlueprintCallable)
+	void SetIKTransitioning(bool transitioning);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true, meta = (BlueprintThreadSafe))
+	bool IsIKTransitioning() const;
+
 	UPROPERTY()
 	TMap<FName, FTransitIKParams> IKTransitionInitialLocation;
 
@@ -283,4 +633,123 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Movement")
 	bool MovingIdleTransitAnimEnabled;
 
+	/********
+	* CAPTURE
+	*********/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Debug")
+	bool CaptureIKOnStart;
+
+	/** Starts streaming the IK inputs and outputs of every update, an empty path writes to Saved/IKCaptures */
+	UFUNCTION(BlueprintCallable)
+	bool StartIKCapture(const FString& filePath);
+
+	UFUNCTION(BlueprintCallable)
+	void StopIKCapture();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	bool IsCapturingIK() const;
+
+	/*************
+	* LINKED LAYERS
+	**************/
+	/** Linked layers read and solve the IK state of the main instance, their own IKParams are handed over on link */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Layers")
+	bool ShareIKStateWithMainInstance{ true };
+
+	/** Seconds a deactivated layer stays linked, suspended, before its instance is released */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Layers")
+	float SuspendedLayerUnlinkDelay{ 5 };
+
+	UFUNCTION(BlueprintPure, meta = (BlueprintThreadSafe))
+	UBaseAnimInstance* GetIKStateOwner() const;
+
+	/** Links the layer class on first use, later calls only resume it */
+	UFUNCTION(BlueprintCallable)
+	void ActivateLinkedLayer(TSubclassOf<UAnimInstance> layerClass);
+
+	UFUNCTION(BlueprintCallable)
+	void DeactivateLinkedLayer(TSubclassOf<UAnimInstance> layerClass);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	bool IsLinkedLayerActive(TSubclassOf<UAnimInstance> layerClass) const;
+
+	UPROPERTY(BlueprintReadOnly, Transient)
+	bool IsLayerSuspended;
+
+protected:
+
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+
+private:
+
+	bool SolveIKs();
+
+	/** Every entry point, main graph or linked layers, solves once per frame */
+	bool SolveIKsOnce();
+
+	void UpdateLinkedLayers();
+
+	UPROPERTY()
+	TArray<FBaseLinkedLayerState> LinkedLayerStates;
+
+	UFUNCTION()
+	void HandleMontageStarted(UAnimMontage* montage);
+
+	void EnterSettledSleep();
+
+	/** Written by the solve, possibly on an anim worker */
+	std::atomic<int32> SettledFrames{ 0 };
+
+	FVector VelocityAtSleep{ FVector::Zero() };
+
+	FTransform MeshTransformAtSleep{ FTransform::Identity };
+
+	/** Asleep while culled, the frozen pose is stale once the mesh is seen again */
+	bool RenderedAtSleep{ true };
+
+	/** Ground under the feet when falling asleep, moving platforms wake the character */
+	TArray<TPair<TWeakObjectPtr<UPrimitiveComponent>, FTransform>> SleepGroundTransforms;
+
+	float TickIntervalBeforeSleep{ 0 };
+
+	uint64 LastIKSolveFrame{ 0 };
+
+	bool LastIKSolveResult{ false };
+
+	void UpdateIKComponentSpace();
+
+	FVector ResolveIKStartTrace(const FIKParams& ikParams, FVector& startReference) const;
+
+	/** Game thread, projects every foot on the navmesh at once before the update, TraceIKGround reads the result of SolvingIKIndex */
+	void BatchProjectIKNavGround();
+
+	TArray<FIKNavGroundQuery> NavGroundQueries;
+
+	/** Sorted once when IKParams is set up or a layer merges into it, not on every solve */
+	TArray<FName> IKReplicationOrder;
+
+	void RefreshIKReplicationOrder();
+
+	/** Index of the IK in the current solve, INDEX_NONE outside of it */
+	int32 SolvingIKIndex{ INDEX_NONE };
+
+	/** Ground from the contacts replicated by the authority, for simulated proxies that skip their traces */
+	bool TraceReplicatedIKGround(const ABase& character, int32 footIndex, const FIKParams& ikParams, const FVector& startTrace, FHitResult& traceResult) const;
+
+	/** Mesh transform of the current update without scale, same space as FinalIKLocation */
+	FTransform IKComponentTransform{ FTransform::Identity };
+
+	bool IKComponentSpaceValid{ false };
+
+	FIKGroundQueryParams IKQueryParams;
+
+	TWeakObjectPtr<UIKBudgetSubsystem> IKBudget;
+
+	/** Configured Weight and RotationWeight of each IK while the Off tier holds them at zero */
+	TMap<FName, FVector2f> WeightsBeforeOff;
+
+	TSharedPtr<FIKCaptureWriter> IKCaptureWriter;
+
+	EVisibilityBasedAnimTickOption VisibilityBasedAnimTickOptionBeforeLeading{ EVisibilityBasedAnimTickOption::AlwaysTickPose };
+
 };
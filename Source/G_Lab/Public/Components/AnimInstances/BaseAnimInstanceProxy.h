@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "Components/AnimInstances/BaseAnimInstance.h"
+
+/**
+ * Gathers the owner velocity on the game thread and resolves the velocity stats on the anim worker,
+ * so the sample anim graphs can read them from thread safe functions.
+ */
+struct G_LAB_API FBaseAnimInstanceProxy : public FAnimInstanceProxy
+{
+public:
+
+	FBaseAnimInstanceProxy() {};
+
+	FBaseAnimInstanceProxy(UAnimInstance* animInstance) : FAnimInstanceProxy(animInstance) {};
+
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+
+	virtual void Update(float DeltaSeconds) override;
+
+	virtual void PostUpdate(UAnimInstance* InAnimInstance) const override;
+
+	FBaseVelocityStats VelocityStats;
+
+private:
+
+	FVector OwnerVelocity{ FVector::Zero() };
+
+	float IdleMoveThreshold{ 0 };
+
+	bool ComputeVelocityStats{ false };
+};
@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UBaseAnimInstance;
+class FArchive;
+
+/**
+ * Capture file layout, plain fixed size records so a capture can be memory mapped:
+ * FIKCaptureFileHeader, NumIKs * FIKCaptureIKConfig, NumRoots * FIKCaptureRootConfig,
+ * then frames of FrameSize bytes: FIKCaptureFrameHeader, NumIKs * FIKCaptureIKRecord, NumRoots * FIKCaptureRootRecord.
+ */
+namespace IKCapture
+{
+	static constexpr uint32 Magic = 0x50434B49; // "IKCP"
+	static constexpr uint32 Version = 2;
+	static constexpr int32 MaxNameLength = 64;
+	static constexpr int32 MaxRootChildIKs = 4;
+}
+
+struct FIKCaptureFileHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 NumIKs;
+	uint32 NumRoots;
+	uint32 FrameSize;
+	uint32 Reserved;
+};
+
+struct FIKCaptureIKConfig
+{
+	ANSICHAR Name[IKCapture::MaxNameLength];
+	FVector3d TraceDirection;
+	FVector3d StartTraceMask;
+	FRotator3d EffectorAddtiveRotationOffset;
+	float Padding;
+	float MaxLength;
+	uint8 AddRelativeLocationFromReverseMask;
+	uint8 AlignEffectorBoneToSurface;
+	uint8 HasStartTraceBoneReference;
+	uint8 Reserved[5];
+};
+
+struct FIKCaptureRootConfig
+{
+	int32 ChildIKs[IKCapture::MaxRootChildIKs];
+	int32 NumChildIKs;
+	int32 Reserved;
+};
+
+struct FIKCaptureFrameHeader
+{
+	uint64 FrameNumber;
+	double TimeSeconds;
+	FVector3d Velocity;
+	FQuat4d MeshRotation;
+	FVector3d MeshLocation;
+	float DeltaSeconds;
+	uint8 IsTransitioning;
+	uint8 ExecutionContext;
+	uint8 QualityTier;
+	uint8 Reserved;
+};
+
+struct FIKCaptureIKRecord
+{
+	/** Inputs */
+	FVector3d SocketLocation;
+	FVector3d ReverseMaskStartTraceLocation;
+	FVector3d PreviousLockLocation;
+	FVector3d ImpactPoint;
+	FVector3d HitNormal;
+	FVector3f PreviousComponentLockLocation;
+	float Weight;
+	float LockWeight;
+	float RotationWeight;
+	uint8 Hitted;
+	uint8 Transitioning;
+	uint8 Reserved[2];
+
+	/** Outputs */
+	FVector3d StartReferenceLocation;
+	FVector3d CurrentLockLocation;
+	FVector3d FinalIKLocation;
+	FRotator3d EffectorAddtiveRotation;
+	FVector3f ComponentLockLocation;
+	uint8 OutputReserved[4];
+};
+
+struct FIKCaptureRootRecord
+{
+	FVector3d RootReferenceLocation;
+	FVector3d RootLocation;
+	float RootIKWeight;
+	uint8 RootShouldDealocate;
+	uint8 Reserved[3];
+};
+
+/**
+ * Appends one record per UpdateIKs to a capture file, buffered and flushed in blocks.
+ */
+class G_LAB_API FIKCaptureWriter
+{
+public:
+
+	~FIKCaptureWriter();
+
+	bool Open(const FString& filePath, const UBaseAnimInstance& animInstance);
+
+	void Close();
+
+	bool IsOpen() const;
+
+	/** Call before the solve, the previous lock locations are inputs of the frame */
+	void BeginFrame(const UBaseAnimInstance& animInstance);
+
+	void EndFrame(const UBaseAnimInstance& animInstance, float deltaSeconds);
+
+	/** Game thread only, writes the buffered frames once they reach the flush threshold */
+	void FlushBuffered();
+
+	const FString& GetFilePath() const;
+
+private:
+
+	void Flush();
+
+	FString FilePath;
+
+	TUniquePtr<FArchive> File;
+
+	TArray<FName> IKNames;
+
+	TArray<int32> RootChildCounts;
+
+	TArray<FVector> PreviousLockLocations;
+
+	TArray<FVector3f> PreviousComponentLockLocations;
+
+	TArray<uint8> Buffer;
+
+	uint32 FrameSize{ 0 };
+
+	uint64 FrameNumber{ 0 };
+};
+
+struct FIKCaptureReplayReport
+{
+	int32 NumFrames{ 0 };
+
+	int32 NumComparedFrames{ 0 };
+
+	int32 NumMismatches{ 0 };
+
+	int64 FirstMismatchFrame{ INDEX_NONE };
+
+	double MaxLocationError{ 0 };
+
+	double MaxRotationError{ 0 };
+};
+
+/**
+ * Feeds a capture back through IKMath without a world and diffs the recorded outputs.
+ */
+class G_LAB_API FIKCaptureReplayer
+{
+public:
+
+	static bool Replay(const FString& filePath, double tolerance, FIKCaptureReplayReport& report);
+};
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/AnimInstances/BaseAnimInstance.h"
+#include "Components/AnimInstances/IKGroundQueryParams.h"
+
+struct FHitResult;
+
+/**
+ * Tiered ground query shared by every IK solver: line trace first,
+ * sphere sweep on misses, slopes and edges, footprint sampling on steps.
+ */
+struct G_LAB_API FIKGroundQuery
+{
+	/** lastImpactPoint is the unpadded impact of the previous query, the adaptive edge test compares heights with it */
+	static bool Trace(
+			UWorld* world
+		,	const FIKParams& ikParams
+		,	const FVector& startTrace
+		,	const FVector& lastImpactPoint
+		,	EIKGroundQueryMode queryMode
+		,	const FIKGroundQueryParams& queryParams
+		,	FHitResult& traceResult
+	);
+
+private:
+
+	static bool QueryPhysics(
+			UWorld* world
+		,	const FIKParams& ikParams
+		,	const FVector& startTrace
+		,	const FVector& lastImpactPoint
+		,	EIKGroundQueryMode queryMode
+		,	const FIKGroundQueryParams& queryParams
+		,	FHitResult& traceResult
+	);
+
+	static bool SampleFootprint(
+			UWorld* world
+		,	const FIKParams& ikParams
+		,	const FVector& startTrace
+		,	const FIKGroundQueryParams& queryParams
+		,	FHitResult& traceResult
+	);
+};
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Engine/EngineTypes.h"
+
+class UIKGroundQueryCache;
+
+/**
+ * Collision settings prebuilt once per solver, one trace tag per query tier.
+ */
+struct G_LAB_API FIKGroundQueryParams
+{
+	ECollisionChannel Channel{ ECollisionChannel::ECC_GameTraceChannel1 };
+
+	FCollisionQueryParams Line;
+
+	FCollisionQueryParams Sweep;
+
+	FCollisionQueryParams Footprint;
+
+	/** Shared results of nearby solvers, queried before physics when set */
+	TWeakObjectPtr<UIKGroundQueryCache> Cache;
+
+	void Build(ECollisionChannel channel, const TArray<AActor*>& ignoredActors);
+};
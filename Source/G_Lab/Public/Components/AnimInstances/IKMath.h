@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/AnimInstances/BaseAnimInstance.h"
+
+/**
+ * World independent IK math, shared by UBaseAnimInstance and the crowd solvers.
+ */
+namespace IKMath
+{
+	inline FVector ResolveStartTrace(const FIKParams& ikParams, const FVector& referenceLocation, FVector& startReference)
+	{
+		startReference = referenceLocation * ikParams.StartTraceMask;
+		FVector startTrace = FVector(startReference);
+
+		if (ikParams.AddRelativeLocationFromReverseMask)
+		{
+			FVector reverseMask = FVector(1) - ikParams.StartTraceMask;
+			startTrace += reverseMask * ikParams.ReverseMaskStartTraceLocation;
+		}
+
+		return startTrace;
+	}
+
+	inline FVector ResolveIKLocation(
+			const FIKParams& ikParams
+		,	const FVector& impactPoint
+		,	const FVector& lockLocation
+		,	float lockWeight
+	)
+	{
+		return FMath::Lerp(
+				impactPoint + ((ikParams.TraceDirection * -1) * ikParams.Padding)
+			,	lockLocation
+			,	lockWeight
+		);
+	}
+
+	inline FRotator ResolveSurfaceAlignment(const FIKParams& ikParams, const FVector& hitNormal)
+	{
+		float asideAlignment = FMath::RadiansToDegrees(FMath::Atan2(hitNormal.Y, hitNormal.Z));
+		float forwardAlignment = FMath::RadiansToDegrees(FMath::Atan2(hitNormal.X, hitNormal.Z)) * -1;
+
+		return FRotator(
+				forwardAlignment + ikParams.EffectorAddtiveRotationOffset.Pitch
+			,	0
+			,	asideAlignment + ikParams.EffectorAddtiveRotationOffset.Roll
+		);
+	}
+
+	/** Same space as FIKParams::FinalIKLocation, the mesh scale is ignored */
+	inline FVector ResolveMeshSpaceLocation(const FQuat& meshRotation, const FVector& meshLocation, const FVector& ikLocation)
+	{
+		return FTransform(meshRotation, meshLocation).InverseTransformPosition(ikLocation);
+	}
+
+	inline FVector3f ToComponentSpace(const FTransform& componentTransform, const FVector& worldLocation)
+	{
+		return FVector3f(componentTransform.InverseTransformPosition(worldLocation));
+	}
+
+	inline FVector3f ToComponentDirection(const FTransform& componentTransform, const FVector& worldDirection)
+	{
+		return FVector3f(componentTransform.InverseTransformVector(worldDirection));
+	}
+
+	/** Single precision ResolveIKLocation, every input relative to the mesh */
+	inline FVector3f ResolveComponentIKLocation(
+			const FVector3f& impactPoint
+		,	const FVector3f& lockLocation
+		,	const FVector3f& traceDirection
+		,	float padding
+		,	float lockWeight
+	)
+	{
+		return FMath::Lerp(
+				impactPoint + ((traceDirection * -1) * padding)
+			,	lockLocation
+			,	lockWeight
+		);
+	}
+
+	/** Finds the child IK exceeding its MaxLength the most, returns false when none of them does */
+	inline bool ResolveRootDislocation(
+			const FVector3f& rootLocation
+		,	TConstArrayView<const FIKParams*> childIKs
+		,	FVector& directionDealocation
+		,	float& excedingDealocation
+	)
+	{
+		bool rootShouldDealocate = false;
+		excedingDealocation = 0;
+		directionDealocation = FVector::Zero();
+
+		for (const FIKParams* childIK : childIKs)
+		{
+			FVector3f ikDealocation = childIK->ComponentLockLocation - rootLocation;
+
+			float currentExcedingDealocation = ikDealocation.Length() - childIK->MaxLength;
+
+			if (currentExcedingDealocation > 0 && currentExcedingDealocation > excedingDealocation)
+			{
+				excedingDealocation = currentExcedingDealocation;
+				directionDealocation = childIK->TraceDirection;
+				rootShouldDealocate = true;
+			}
+		}
+
+		return rootShouldDealocate;
+	}
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/Navigation/NavigationTypes.h"
+
+class UWorld;
+class ARecastNavMesh;
+struct FHitResult;
+
+struct FIKNavGroundQuery
+{
+	FVector StartTrace{ FVector::Zero() };
+
+	FVector TraceDirection{ FVector::DownVector };
+
+	float TraceLength{ 0 };
+
+	float TraceRadius{ 0 };
+
+	bool Hitted{ false };
+
+	FVector Location{ FVector::Zero() };
+
+	FVector Normal{ FVector::UpVector };
+};
+
+/**
+ * Projects IK traces onto the Recast navmesh instead of the physics scene.
+ * The hit stays on the trace, only its height and the surface normal come from the nav poly.
+ */
+struct G_LAB_API FIKNavGroundProjection
+{
+	static bool Project(
+			UWorld* world
+		,	const FVector& startTrace
+		,	const FVector& traceDirection
+		,	float traceLength
+		,	float traceRadius
+		,	float maxSurfaceAngle
+		,	FHitResult& traceResult
+	);
+
+	/** One nav query for every foot of a character or a Mass chunk, game thread only like Project */
+	static void ProjectBatch(UWorld* world, TArray<FIKNavGroundQuery>& queries, float maxSurfaceAngle);
+
+	static void BuildHitResult(const FIKNavGroundQuery& query, FHitResult& traceResult);
+
+private:
+
+	static ARecastNavMesh* GetNavMesh(UWorld* world);
+
+	static bool RefineProjection(
+			const ARecastNavMesh* navMesh
+		,	const FIKNavGroundQuery& query
+		,	NavNodeRef polyRef
+		,	const FVector& projectedLocation
+		,	float maxSurfaceAngle
+		,	FVector& outLocation
+		,	FVector& outNormal
+	);
+};
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Entities/Characters/IKContactSummary.h"
 #include "Base.generated.h"
 
 class UInputMappingContext;
@@ -22,13 +23,22 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	// Per frame work of the character, called by Tick or by the crowd tick manager when the actor tick is disabled
+	virtual void BatchedTick(float DeltaTime);
+
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	virtual void NotifyControllerChanged() override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Input|Settings")
 	UInputMappingContext* InputMappings;
 
@@ -44,4 +54,88 @@ public:
 	UFUNCTION()
 	void Move(const FInputActionValue& value);
 
+	/*************
+	* BATCHED TICK
+	**************/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings|Tick")
+	bool UseBatchedTick{ true };
+
+	void UpdateTickMode();
+
+	int32 BatchedTickIndex{ INDEX_NONE };
+
+	/**************
+	* INPUT LATENCY
+	***************/
+	/** Only bound while the character is a locally controlled player */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings|Input")
+	bool InstrumentInputLatency{ false };
+
+	UPROPERTY(BlueprintReadOnly)
+	float LastInputToMovementMs;
+
+	UPROPERTY(BlueprintReadOnly)
+	float LastInputToPoseMs;
+
+	UFUNCTION()
+	void OnInputMovementApplied(float deltaSeconds, FVector oldLocation, FVector oldVelocity);
+
+	UFUNCTION()
+	void OnInputPoseFinalized();
+
+	/************
+	* IK CONTACTS
+	*************/
+	/** Sends the authority foot contacts to simulated proxies, dedicated servers then solve IK contact only */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings|Network")
+	bool ReplicateIKContacts;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings|Network")
+	float IKContactSendRate{ 10 };
+
+	/** Simulated proxies at least this far from the local view use the replicated contacts instead of tracing */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings|Network")
+	float ReplicatedIKContactMinDistance{ 1500 };
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings|Network")
+	float IKContactInterpolationTime{ 0.1f };
+
+	UPROPERTY(ReplicatedUsing = OnRep_IKContactSummary)
+	FIKContactSummary IKContactSummary;
+
+	UFUNCTION()
+	void OnRep_IKContactSummary(const FIKContactSummary& oldSummary);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	bool UsesReplicatedIKContacts() const;
+
+	/** Interpolated contact of a foot, in mesh space, returns false when the authority foot has no ground */
+	bool GetReplicatedIKContact(int32 footIndex, float& impactHeight, FVector3f& impactNormal) const;
+
+	float GetReplicatedIKRootOffset(int32 rootIndex) const;
+
+private:
+
+	void TickIKContacts(float deltaSeconds);
+
+	void UpdateIKContactSummary();
+
+	void TickSettledSleep();
+
+	FIKContactSummary PreviousIKContactSummary;
+
+	float IKContactInterpolationAlpha{ 1 };
+
+	float TimeSinceIKContactSend{ 0 };
+
+	bool UseReplicatedIKContacts{ false };
+
+	void MarkInputReceived();
+
+	void UpdateInputLatencyBindings();
+
+	uint64 PendingInputCycles{ 0 };
+
+	uint64 InputMovementCycles{ 0 };
+
 };
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IKContactSummary.generated.h"
+
+/**
+ * Ground contact of every foot of a character, quantized when built so equal contacts are not resent.
+ * Heights and root offsets are mesh relative in millimeters, normals are octahedral encoded in two bytes.
+ */
+USTRUCT()
+struct G_LAB_API FIKContactSummary
+{
+	GENERATED_BODY()
+
+public:
+
+	static constexpr int32 MaxFeet = 4;
+
+	static constexpr int32 MaxRoots = 2;
+
+	void SetFoot(int32 footIndex, bool hitted, bool planted, float impactHeight, const FVector3f& impactNormal);
+
+	void SetRootOffset(int32 rootIndex, float rootOffset);
+
+	bool IsHitted(int32 footIndex) const;
+
+	bool IsPlanted(int32 footIndex) const;
+
+	float GetImpactHeight(int32 footIndex) const;
+
+	FVector3f GetImpactNormal(int32 footIndex) const;
+
+	float GetRootOffset(int32 rootIndex) const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FIKContactSummary& other) const;
+
+	uint8 NumFeet{ 0 };
+
+	uint8 NumRoots{ 0 };
+
+private:
+
+	uint8 HittedMask{ 0 };
+
+	uint8 PlantedMask{ 0 };
+
+	int16 ImpactHeights[MaxFeet] = {};
+
+	uint8 ImpactNormals[MaxFeet][2] = {};
+
+	int16 RootOffsets[MaxRoots] = {};
+};
+
+template<>
+struct TStructOpsTypeTraits<FIKContactSummary> : public TStructOpsTypeTraitsBase2<FIKContactSummary>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
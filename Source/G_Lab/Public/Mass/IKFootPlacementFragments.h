@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "Components/AnimInstances/BaseAnimInstance.h"
+#include "IKFootPlacementFragments.generated.h"
+
+class UBaseAnimInstance;
+
+USTRUCT()
+struct FMassIKFootConfig
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Key of the matching entry in UBaseAnimInstance::IKParams, used to carry state over on promotion */
+	UPROPERTY(EditAnywhere)
+	FName IKName;
+
+	/** Stand in for StartTraceBoneReference, relative to the entity transform */
+	UPROPERTY(EditAnywhere)
+	FVector LocalStartReference{ FVector::Zero() };
+
+	UPROPERTY(EditAnywhere)
+	FIKParams Params;
+
+};
+
+USTRUCT()
+struct FMassIKFootState
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	FVector StartReferenceLocation{ FVector::Zero() };
+
+	UPROPERTY()
+	FVector CurrentLockLocation{ FVector::Zero() };
+
+	/** Unpadded ground hit of the last query, the adaptive query edge reference */
+	UPROPERTY()
+	FVector ImpactPoint{ FVector::Zero() };
+
+	UPROPERTY()
+	FVector HitNormal{ FVector::UpVector };
+
+	UPROPERTY()
+	FRotator EffectorAddtiveRotation{ FRotator::ZeroRotator };
+
+	/** Relative to the entity transform, same role as FIKParams::FinalIKLocation */
+	UPROPERTY()
+	FVector FinalIKLocation{ FVector::Zero() };
+
+	UPROPERTY()
+	float Weight{ 0 };
+
+	UPROPERTY()
+	bool Hitted{ false };
+
+	UPROPERTY()
+	bool Planted{ false };
+
+};
+
+USTRUCT()
+struct G_LAB_API FMassIKFootPlacementFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+public:
+
+	static constexpr int32 MaxFeet = 4;
+
+	UPROPERTY()
+	FMassIKFootState Feet[MaxFeet];
+
+	/** Set while a full ABase actor represents the entity and owns the solve */
+	UPROPERTY()
+	bool RepresentedByActor{ false };
+
+};
+
+USTRUCT()
+struct G_LAB_API FMassIKFootPlacementConfigFragment : public FMassConstSharedFragment
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditAnywhere)
+	TArray<FMassIKFootConfig> Feet;
+
+	UPROPERTY(EditAnywhere)
+	TEnumAsByte<ECollisionChannel> GroundChannel{ ECollisionChannel::ECC_GameTraceChannel1 };
+
+	/** NavMesh chunks are projected in batches by UMassIKNavFootPlacementProcessor, misses fall back to physics */
+	UPROPERTY(EditAnywhere)
+	EIKGroundSource GroundSource{ EIKGroundSource::Physics };
+
+	UPROPERTY(EditAnywhere)
+	float NavMeshMaxSurfaceAngle{ 20 };
+
+	void CopyToAnimInstance(const FMassIKFootPlacementFragment& fragment, UBaseAnimInstance& animInstance) const;
+
+	void CopyFromAnimInstance(const UBaseAnimInstance& animInstance, FMassIKFootPlacementFragment& fragment) const;
+
+};
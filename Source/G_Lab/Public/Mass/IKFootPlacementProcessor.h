@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "IKFootPlacementProcessor.generated.h"
+
+/**
+ * Runs the UBaseAnimInstance ground query, lock, weight and alignment logic
+ * over chunks of crowd entities in parallel, for entities without an actor.
+ */
+UCLASS()
+class G_LAB_API UMassIKFootPlacementProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+
+	UMassIKFootPlacementProcessor();
+
+protected:
+
+	virtual void ConfigureQueries() override;
+
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+
+	FMassEntityQuery EntityQuery;
+
+};
+
+/**
+ * Same solve for chunks whose ground source is the navmesh, on the game thread
+ * since Recast can not be queried while tiles rebuild, one nav query per chunk.
+ */
+UCLASS()
+class G_LAB_API UMassIKNavFootPlacementProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+
+	UMassIKNavFootPlacementProcessor();
+
+protected:
+
+	virtual void ConfigureQueries() override;
+
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+
+	FMassEntityQuery EntityQuery;
+
+};
+
+/**
+ * Carries IK state between the entity and its ABase representation:
+ * pushed into the anim instance on promotion, mirrored back while the actor exists.
+ */
+UCLASS()
+class G_LAB_API UMassIKActorSyncProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+
+	UMassIKActorSyncProcessor();
+
+protected:
+
+	virtual void ConfigureQueries() override;
+
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+
+	FMassEntityQuery EntityQuery;
+
+};
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTraitBase.h"
+#include "Mass/IKFootPlacementFragments.h"
+#include "IKFootPlacementTrait.generated.h"
+
+/**
+ * Adds crowd foot placement to a Mass entity config. Pair it with a representation trait
+ * spawning an ABase near the camera, the IK state is carried over on promotion and demotion.
+ */
+UCLASS(meta = (DisplayName = "IK Foot Placement"))
+class G_LAB_API UMassIKFootPlacementTrait : public UMassEntityTraitBase
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditAnywhere, Category = "IK")
+	FMassIKFootPlacementConfigFragment Config;
+
+protected:
+
+	virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+
+};
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BaseAnimSharingSubsystem.generated.h"
+
+class UBaseAnimInstance;
+
+/**
+ * Groups UBaseAnimInstances by skeleton and locomotion state and elects one leader per group.
+ * Leaders evaluate the full locomotion graph, followers copy the leader pose and only run their own IK.
+ */
+UCLASS()
+class G_LAB_API UBaseAnimSharingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	void Register(UBaseAnimInstance* animInstance);
+
+	void Unregister(UBaseAnimInstance* animInstance);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	int32 GetNumLeaders() const;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float ReassignInterval{ 0.25f };
+
+	/** Horizontal speed range, in cm/s, grouped in a single locomotion state */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float SpeedBucketSize{ 50 };
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	uint32 GetLocomotionStateKey(const UBaseAnimInstance* animInstance) const;
+
+	void ReassignLeaders();
+
+	UPROPERTY()
+	TArray<TObjectPtr<UBaseAnimInstance>> Instances;
+
+	float TimeSinceReassign{ 0 };
+
+	int32 NumLeaders{ 0 };
+
+};
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BaseCrowdTickSubsystem.generated.h"
+
+class ABase;
+
+/**
+ * Ticks every registered ABase from a single tickable over a contiguous array,
+ * replacing one actor tick function per crowd character.
+ */
+UCLASS()
+class G_LAB_API UBaseCrowdTickSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	void Register(ABase* character);
+
+	void Unregister(ABase* character);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	int32 GetNumCharacters() const;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	UPROPERTY()
+	TArray<TObjectPtr<ABase>> Characters;
+
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include "Components/AnimInstances/BaseAnimInstance.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "IKBudgetSubsystem.generated.h"
+
+/**
+ * Holds the IK solve of every registered UBaseAnimInstance under a fixed frame budget.
+ * Instances report the cost of their solve, every frame the most significant ones get
+ * the best quality tier the remaining milliseconds can afford. Budget set by GLab.IKBudget.BudgetMs.
+ */
+UCLASS()
+class G_LAB_API UIKBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	void Register(UBaseAnimInstance* animInstance);
+
+	void Unregister(UBaseAnimInstance* animInstance);
+
+	/** Thread safe, called from the anim update of each instance */
+	void ReportCost(EIKQualityTier tier, uint64 cycles);
+
+	/** Distance, in cm, at which the significance of a visible character halves */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float SignificanceDistance{ 1500 };
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float CostSmoothing{ 0.1f };
+
+	/** Seconds an instance keeps its tier before it can be moved, characters near the cutoff would flip every frame */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float MinTierTime{ 0.5f };
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	float GetUsedMs() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	int32 GetNumInstancesInTier(EIKQualityTier tier) const;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	static constexpr int32 NumTiers = (int32)EIKQualityTier::Off + 1;
+
+	void AssignTiers();
+
+	float GetSignificance(const UBaseAnimInstance* animInstance, TConstArrayView<FVector> viewLocations) const;
+
+	/** Sleeping, skipped and contact only instances do not run the budgeted solve */
+	static bool IsBudgeted(const UBaseAnimInstance* animInstance);
+
+	UPROPERTY()
+	TArray<TObjectPtr<UBaseAnimInstance>> Instances;
+
+	std::atomic<uint64> FrameCycles[NumTiers] = {};
+
+	std::atomic<int32> FrameSolves[NumTiers] = {};
+
+	/** Smoothed cost of one solve per tier, seeded until the first reports arrive */
+	float TierCostMs[NumTiers] = { 0.05f, 0.03f, 0.002f, 0 };
+
+	int32 TierCounts[NumTiers] = {};
+
+	float UsedMs{ 0 };
+
+};
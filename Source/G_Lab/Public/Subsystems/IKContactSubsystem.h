@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "IKContactSubsystem.generated.h"
+
+class UPrimitiveComponent;
+
+UENUM(BlueprintType)
+enum class EIKContactEventType : uint8
+{
+	Plant,
+	Lift
+};
+
+USTRUCT(BlueprintType)
+struct FIKContactEvent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintReadOnly)
+	EIKContactEventType Type{ EIKContactEventType::Plant };
+
+	UPROPERTY(BlueprintReadOnly)
+	FName IKName;
+
+	UPROPERTY(BlueprintReadOnly)
+	TWeakObjectPtr<AActor> Owner;
+
+	UPROPERTY(BlueprintReadOnly)
+	TWeakObjectPtr<UPrimitiveComponent> HitComponent;
+
+	UPROPERTY(BlueprintReadOnly)
+	FVector Location{ FVector::Zero() };
+
+	UPROPERTY(BlueprintReadOnly)
+	FVector HitNormal{ FVector::UpVector };
+
+	UPROPERTY(BlueprintReadOnly)
+	float TimeSeconds{ 0 };
+
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnIKContactEvents, const TArray<FIKContactEvent>&, events);
+
+/**
+ * Per-world stream of foot plant/lift events produced by the IK solve.
+ * Publishing is lock-free and may happen from any anim worker thread,
+ * consumers receive the whole batch once per frame on the game thread.
+ */
+UCLASS()
+class G_LAB_API UIKContactSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	void Publish(const FIKContactEvent& contactEvent);
+
+	UPROPERTY(BlueprintAssignable)
+	FOnIKContactEvents OnContactEvents;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	const TArray<FIKContactEvent>& GetLastFrameEvents() const;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	TQueue<FIKContactEvent, EQueueMode::Mpsc> PendingEvents;
+
+	UPROPERTY()
+	TArray<FIKContactEvent> DrainedEvents;
+
+};
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "IKGroundQueryCache.generated.h"
+
+class UPrimitiveComponent;
+struct FCollisionQueryParams;
+
+struct FIKGroundQueryCacheKey
+{
+	FIntVector Origin{ FIntVector::ZeroValue };
+
+	FIntVector Direction{ FIntVector::ZeroValue };
+
+	int32 Radius{ 0 };
+
+	int32 Length{ 0 };
+
+	uint8 Channel{ 0 };
+
+	uint8 QueryMode{ 0 };
+
+	bool operator==(const FIKGroundQueryCacheKey& other) const
+	{
+		return this->Origin == other.Origin
+			&& this->Direction == other.Direction
+			&& this->Radius == other.Radius
+			&& this->Length == other.Length
+			&& this->Channel == other.Channel
+			&& this->QueryMode == other.QueryMode;
+	}
+
+	friend uint32 GetTypeHash(const FIKGroundQueryCacheKey& key)
+	{
+		uint32 hash = HashCombineFast(GetTypeHash(key.Origin), GetTypeHash(key.Direction));
+		hash = HashCombineFast(hash, GetTypeHash(key.Radius));
+		hash = HashCombineFast(hash, GetTypeHash(key.Length));
+		return HashCombineFast(hash, (key.Channel << 8) | key.QueryMode);
+	}
+};
+
+struct FIKGroundQueryCacheEntry
+{
+	/** Impact distance along the trace direction, reapplied to the origin of the query that reads it */
+	float Distance{ 0 };
+
+	FVector Normal{ FVector::UpVector };
+
+	TWeakObjectPtr<UPrimitiveComponent> HitComponent;
+
+	/** Hit component transform when the entry was stored, any movement invalidates the entry */
+	FTransform ComponentTransform{ FTransform::Identity };
+
+	double ExpireTime{ 0 };
+};
+
+/**
+ * Per-world ground query results shared by every IK solver.
+ * Traces are keyed by a quantized origin, direction, radius and length so nearby characters
+ * reuse the same ground patch instead of querying physics again. Safe to read and write from anim workers.
+ */
+UCLASS()
+class G_LAB_API UIKGroundQueryCache : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	FIKGroundQueryCacheKey MakeKey(
+			const FVector& startTrace
+		,	const FVector& traceDirection
+		,	float traceRadius
+		,	float traceLength
+		,	ECollisionChannel channel
+		,	uint8 queryMode
+	) const;
+
+	bool Find(
+			const FIKGroundQueryCacheKey& key
+		,	const FVector& startTrace
+		,	const FVector& traceDirection
+		,	const FCollisionQueryParams& queryParams
+		,	FHitResult& traceResult
+	);
+
+	void Store(const FIKGroundQueryCacheKey& key, const FVector& traceDirection, const FHitResult& traceResult);
+
+	/** Size, in cm, of the cells trace origins are snapped to */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float CellSize{ 5 };
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float TimeToLive{ 0.25f };
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int32 MaxEntries{ 8192 };
+
+	UFUNCTION(BlueprintCallable, BlueprintPure = true)
+	float GetHitRate() const;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	bool IsCacheable(const FHitResult& traceResult) const;
+
+	TMap<FIKGroundQueryCacheKey, FIKGroundQueryCacheEntry> Entries;
+
+	mutable FRWLock EntriesLock;
+
+	std::atomic<int32> FrameHits{ 0 };
+
+	std::atomic<int32> FrameMisses{ 0 };
+
+	std::atomic<int32> FrameInvalidations{ 0 };
+
+	float LastHitRate{ 0 };
+
+};